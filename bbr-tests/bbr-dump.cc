@@ -0,0 +1,54 @@
+//
+// Dump BBR' record file (from BbrRecorder) as CSV to stdout.
+//
+// Usage:
+//
+//   ./waf --run "bbr-dump --file=bulk.rec"
+//
+// One line per record: time (s), flow, cwnd (bytes), inflight
+// (bytes), RTT (ms), pacing rate (Mb/s), BW (Mb/s), BBR' state.
+//
+
+// System includes.
+#include <iostream>
+#include <string>
+
+// NS3 includes.
+#include "ns3/core-module.h"
+#include "ns3/tcp-bbr-recorder.h"
+
+using namespace ns3;
+
+/////////////////////////////////////////////////
+int main (int argc, char *argv[]) {
+
+  std::string file = "bulk.rec";
+  int flow = -1;
+
+  CommandLine cmd;
+  cmd.AddValue("file", "Record file (from BbrRecorder)", file);
+  cmd.AddValue("flow", "Only dump flow (-1 for all)", flow);
+  cmd.Parse(argc, argv);
+
+  BbrRecordReader reader;
+  if (!reader.Open(file)) {
+    std::cerr << "Can't read record file: " << file << std::endl;
+    return 1;
+  }
+
+  std::cout << "time,flow,cwnd,inflight,rtt,pacing_rate,bw,state" << std::endl;
+  for (const bbr::record *r = reader.begin(); r != reader.end(); r++) {
+    if (flow >= 0 && r -> flow != (uint32_t) flow)
+      continue;
+    std::cout << r -> time / 1e9 << ","
+              << r -> flow << ","
+              << r -> cwnd << ","
+              << r -> inflight << ","
+              << r -> rtt / 1e6 << ","
+              << r -> pacing_rate << ","
+              << r -> bw << ","
+              << r -> state << std::endl;
+  }
+
+  return 0;
+}
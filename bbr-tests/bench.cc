@@ -0,0 +1,241 @@
+//
+// Simulator speed benchmark for BBR'.
+//
+// Network topology
+//
+//       n0 ------------ (n1/router) -------------- n2
+//
+// - For each bottleneck rate (--rates) and number of flows (--flows),
+//   runs N bulk flows from n0 to n2 for --duration simulated seconds
+//   and writes one CSV line: wall time, simulated seconds per wall
+//   second, events executed, peak RSS and, if built with
+//   -DTCP_BBR_PROFILE, calls and time in TcpBbr::PktsAcked(),
+//   TcpBbr::Send() and TcpSocketBase::PacePackets().
+//
+// - Each point runs in its own (forked) process, so peak RSS is for
+//   that point only.
+//
+//     ./waf --run "bench --rates=10Mbps,1Gbps --flows=1,100 --output=bench.csv"
+//
+
+// System includes.
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// NS3 includes.
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/network-module.h"
+#include "ns3/packet-sink.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/tcp-bbr-profile.h"
+
+using namespace ns3;
+
+// For logging.
+
+NS_LOG_COMPONENT_DEFINE ("main");
+
+// Benchmark parameters (same for all points).
+struct bench_config {
+  std::string tcp;         // TCP congestion control.
+  std::string delay;       // Bottleneck delay.
+  double duration;         // Simulated seconds.
+  uint32_t queue_size;     // Packets.
+  uint32_t packet_size;    // Bytes.
+};
+
+// Split comma-separated list.
+std::vector<std::string> split(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+// Write CSV header.
+void header(std::ostream &out) {
+  out << "tcp,rate_bps,flows,sim_seconds,wall_seconds,sim_per_wall,"
+      << "events,events_per_second,peak_rss_kb,throughput_mbps";
+  for (int i = 0; i < bbr::PROFILE_POINTS; i++)
+    out << "," << bbr::profileName(i) << "_calls"
+        << "," << bbr::profileName(i) << "_ns";
+  out << std::endl;
+}
+
+// Run one benchmark point, writing CSV line.
+void run(const bench_config &config, DataRate rate, uint32_t flows,
+         std::ostream &out) {
+
+  /////////////////////////////////////////
+  // Setup environment
+  Config::SetDefault("ns3::TcpL4Protocol::SocketType",
+                     StringValue(config.tcp));
+  Config::SetDefault("ns3::TcpSocket::SegmentSize",
+                     UintegerValue(config.packet_size));
+  Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(0));
+
+  /////////////////////////////////////////
+  // Create nodes and links.
+  NodeContainer nodes;  // 0=source, 1=router, 2=sink
+  nodes.Create(3);
+
+  // Server to router faster than bottleneck.
+  int mtu = 1500;
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute("DataRate",
+                         DataRateValue(DataRate(rate.GetBitRate() * 10)));
+  p2p.SetChannelAttribute("Delay", StringValue ("1ms"));
+  p2p.SetDeviceAttribute ("Mtu", UintegerValue(mtu));
+  NetDeviceContainer devices1 = p2p.Install(nodes.Get(0), nodes.Get(1));
+
+  // Router to client (bottleneck).
+  p2p.SetDeviceAttribute("DataRate", DataRateValue(rate));
+  p2p.SetChannelAttribute("Delay", StringValue (config.delay));
+  p2p.SetQueue("ns3::DropTailQueue",
+               "Mode", StringValue ("QUEUE_MODE_PACKETS"),
+               "MaxPackets", UintegerValue(config.queue_size));
+  NetDeviceContainer devices2 = p2p.Install(nodes.Get(1), nodes.Get(2));
+
+  InternetStackHelper internet;
+  internet.Install(nodes);
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase("10.1.1.0", "255.255.255.0");
+  ipv4.Assign(devices1);
+  ipv4.SetBase("191.168.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i1i2 = ipv4.Assign(devices2);
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+
+  /////////////////////////////////////////
+  // Create apps (flow starts spread over first 100 ms).
+  uint16_t port = 911;
+  BulkSendHelper source("ns3::TcpSocketFactory",
+                        InetSocketAddress(i1i2.GetAddress(1), port));
+  source.SetAttribute("MaxBytes", UintegerValue(0));
+  source.SetAttribute("SendSize", UintegerValue(config.packet_size));
+  for (uint32_t i = 0; i < flows; i++) {
+    ApplicationContainer apps = source.Install(nodes.Get(0));
+    apps.Start(Seconds(0.1 * i / flows));
+    apps.Stop(Seconds(config.duration));
+  }
+  PacketSinkHelper sink("ns3::TcpSocketFactory",
+                        InetSocketAddress(Ipv4Address::GetAny(), port));
+  ApplicationContainer apps = sink.Install(nodes.Get(2));
+  apps.Start(Seconds(0.0));
+  apps.Stop(Seconds(config.duration));
+  Ptr<PacketSink> p_sink = DynamicCast<PacketSink> (apps.Get(0));
+
+  /////////////////////////////////////////
+  // Run simulation (timed).
+  bbr::profileReset();
+  Simulator::Stop(Seconds(config.duration));
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  Simulator::Run();
+  double wall = std::chrono::duration<double>
+    (std::chrono::steady_clock::now() - start).count();
+
+  /////////////////////////////////////////
+  // Ouput stats.
+  uint64_t events = Simulator::GetEventCount();
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double tput = p_sink->GetTotalRx() * 8 / config.duration / 1000000.0;
+
+  out << config.tcp << ","
+      << rate.GetBitRate() << ","
+      << flows << ","
+      << config.duration << ","
+      << wall << ","
+      << config.duration / wall << ","
+      << events << ","
+      << events / wall << ","
+      << usage.ru_maxrss << ","      // Kilobytes (Linux).
+      << tput;
+  for (int i = 0; i < bbr::PROFILE_POINTS; i++)
+    out << "," << bbr::profileCounters()[i].calls
+        << "," << bbr::profileCounters()[i].ns;
+  out << std::endl;
+
+  Simulator::Destroy();
+}
+
+/////////////////////////////////////////////////
+int main (int argc, char *argv[]) {
+
+  /////////////////////////////////////////
+  // Defaults (overridden by command line).
+  std::string rates = "10Mbps,100Mbps,1Gbps,10Gbps,40Gbps";
+  std::string flows = "1,10,100,1000,10000";
+  std::string output = "-";              // CSV file ("-" for stdout).
+  bool fork_points = true;
+  bench_config config;
+  config.tcp = "ns3::TcpBbr";
+  config.delay = "10ms";
+  config.duration = 2.0;
+  config.queue_size = 1000;
+  config.packet_size = 1000;
+
+  CommandLine cmd;
+  cmd.AddValue("rates", "Bottleneck rates, comma-separated list", rates);
+  cmd.AddValue("flows", "Numbers of flows, comma-separated list", flows);
+  cmd.AddValue("tcp", "TCP congestion control", config.tcp);
+  cmd.AddValue("delay", "Bottleneck delay", config.delay);
+  cmd.AddValue("duration", "Simulated time per point (seconds)", config.duration);
+  cmd.AddValue("queueSize", "Bottleneck queue size (packets)", config.queue_size);
+  cmd.AddValue("packetSize", "Packet (segment) size (bytes)", config.packet_size);
+  cmd.AddValue("output", "CSV file (\"-\" for stdout)", output);
+  cmd.AddValue("fork", "Run each point in own process (for peak RSS)",
+               fork_points);
+  cmd.Parse(argc, argv);
+
+  if (!bbr::PROFILE_ENABLED)
+    std::cerr << "Note: not built with -DTCP_BBR_PROFILE, "
+              << "so hot path counters are zero." << std::endl;
+
+  // Header, then points in order.
+  std::ofstream file;
+  if (output != "-")
+    file.open(output.c_str(), std::ios::out | std::ios::trunc);
+  std::ostream &out = (output != "-") ? file : std::cout;
+  header(out);
+  out.flush();
+
+  std::vector<std::string> rate_list = split(rates);
+  std::vector<std::string> flow_list = split(flows);
+  for (size_t r = 0; r < rate_list.size(); r++) {
+    for (size_t f = 0; f < flow_list.size(); f++) {
+      DataRate rate(rate_list[r]);
+      uint32_t n = std::stoul(flow_list[f]);
+      if (!fork_points) {
+        run(config, rate, n, out);
+        continue;
+      }
+
+      // Child runs point, parent waits (so lines stay in order).
+      pid_t pid = fork();
+      if (pid == 0) {
+        run(config, rate, n, out);
+        out.flush();
+        _exit(0);
+      }
+      int status = 0;
+      if (pid < 0 || waitpid(pid, &status, 0) < 0 || status != 0)
+        std::cerr << "Point failed: " << rate_list[r] << " "
+                  << flow_list[f] << " flows" << std::endl;
+    }
+  }
+
+  return 0;
+}
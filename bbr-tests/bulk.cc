@@ -1,18 +1,36 @@
-//           
+//
 // Network topology
 //
-//       n0 ------------ (n1/router) -------------- n2
-//            10.1.1.x                192.168.1.x
-//       10.1.1.1    10.1.1.2   192.16.1.1     192.168.1.2
+//       n0 ------------ (r/router) -------------- c
+//       n1 ----------/  192.168.1.1    192.168.1.2
+//       ...        /
+//       n(N-1) ---/
+//            10.1.i.x
+//
+// - N flows (default 1), flow i from sender ni to client c using
+//   BulkSendApplication, each with its own congestion control (cycled
+//   from --tcp list) and start time (staggered by --stagger).
+//
+// - All parameters are command line options (see --help), so one
+//   build runs any experiment, e.g.:
+//
+//     ./waf --run "bulk --flows=4 --tcp=ns3::TcpBbr,ns3::TcpNewReno
+//                  --bottleneckBw=50Mbps --queueSize=200 --stop=30"
+//
+//   ns-3 attributes can be set on the command line, too, e.g.:
 //
-// - Flow from n0 to n2 using BulkSendApplication.
+//     --ns3::TcpBbr::StartupGain=2.5
 //
 // - Tracing of queues and packet receptions to file "*.tr" and
-//   "*.pcap" when tracing is turned on.
+//   "*.pcap" when tracing is turned on.  BbrRecorder file "bulk.rec"
+//   when recording is turned on.  All written to --output directory.
 //
 
 // System includes.
+#include <iostream>
 #include <string>
+#include <sstream>
+#include <vector>
 #include <fstream>
 
 // NS3 includes.
@@ -21,34 +39,102 @@
 #include "ns3/internet-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
 #include "ns3/packet-sink.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/tcp-bbr-recorder.h"
 
 using namespace ns3;
 
-// Constants.
-#define ENABLE_PCAP      false     // Set to "true" to enable pcap
-#define ENABLE_TRACE     false     // Set to "true" to enable trace
-#define BIG_QUEUE        2000      // Packets
-#define QUEUE_SIZE       100       // Packets
-#define START_TIME       0.0       // Seconds
-#define STOP_TIME        5.0       // Seconds
-#define S_TO_R_BW        "150Mbps" // Server to router
-#define S_TO_R_DELAY     "10ms"
-#define R_TO_C_BW        "10Mbps"  // Router to client (bttlneck)
-#define R_TO_C_DELAY     "1ms"
-#define PACKET_SIZE      1000      // Bytes.
-
-// Uncomment one of the below.
-#define TCP_PROTOCOL     "ns3::TcpBbr"
-//#define TCP_PROTOCOL     "ns3::TcpNewReno"
-
-// For logging. 
+// For logging.
 
 NS_LOG_COMPONENT_DEFINE ("main");
+
+// Split comma-separated list.
+std::vector<std::string> split(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+// Record flow of bulk send application (once socket is made).
+void recordFlow(Ptr<BbrRecorder> recorder, Ptr<BulkSendApplication> app) {
+  Ptr<TcpSocketBase> socket = DynamicCast<TcpSocketBase>(app -> GetSocket());
+  if (socket)
+    recorder -> Add(socket);
+}
+
 /////////////////////////////////////////////////
 int main (int argc, char *argv[]) {
 
+  /////////////////////////////////////////
+  // Defaults (overridden by command line).
+  bool enable_pcap = false;              // Set to "true" to enable pcap
+  bool enable_trace = false;             // Set to "true" to enable trace
+  bool enable_record = false;            // Set to "true" to enable BbrRecorder
+  bool csv = false;                      // Set to "true" for CSV summary
+  uint32_t queue_size = 100;             // Packets
+  std::string queue_disc = "";           // Router queue disc ("" for ns-3 default)
+  double start_time = 0.0;               // Seconds
+  double stop_time = 5.0;                // Seconds
+  double stagger = 0.0;                  // Seconds between flow starts
+  uint32_t flows = 1;
+  std::string s_to_r_bw = "150Mbps";     // Server to router
+  std::string s_to_r_delay = "10ms";
+  std::string r_to_c_bw = "10Mbps";      // Router to client (bttlneck)
+  std::string r_to_c_delay = "1ms";
+  uint32_t packet_size = 1000;           // Bytes.
+  std::string tcp_protocol = "ns3::TcpBbr"; // Or, e.g., "ns3::TcpNewReno"
+  std::string output = ".";              // Directory for output files.
+
+  CommandLine cmd;
+  cmd.AddValue("pcap", "Enable pcap files", enable_pcap);
+  cmd.AddValue("trace", "Enable ascii trace file", enable_trace);
+  cmd.AddValue("record", "Enable BbrRecorder file (bulk.rec)", enable_record);
+  cmd.AddValue("csv",
+               "Print summary as CSV line to stdout: flows, total bytes, "
+               "throughput (Mb/s), then throughput of each flow (Mb/s)",
+               csv);
+  cmd.AddValue("queueSize", "Bottleneck queue size (packets)", queue_size);
+  cmd.AddValue("queueDisc",
+               "Router queue disc type (e.g., ns3::RedQueueDisc, "
+               "\"\" for ns-3 default), limits set via its attributes",
+               queue_disc);
+  cmd.AddValue("start", "Start time of first flow (seconds)", start_time);
+  cmd.AddValue("stop", "Stop time (seconds)", stop_time);
+  cmd.AddValue("stagger", "Time between flow starts (seconds)", stagger);
+  cmd.AddValue("flows", "Number of flows", flows);
+  cmd.AddValue("senderBw", "Server to router bandwidth", s_to_r_bw);
+  cmd.AddValue("senderDelay", "Server to router delay", s_to_r_delay);
+  cmd.AddValue("bottleneckBw", "Router to client bandwidth", r_to_c_bw);
+  cmd.AddValue("bottleneckDelay", "Router to client delay", r_to_c_delay);
+  cmd.AddValue("packetSize", "Packet (segment) size (bytes)", packet_size);
+  cmd.AddValue("tcp",
+               "TCP congestion control, comma-separated list "
+               "cycled over flows (e.g., ns3::TcpBbr,ns3::TcpNewReno)",
+               tcp_protocol);
+  cmd.AddValue("output", "Directory for output files", output);
+  cmd.Parse(argc, argv);
+
+  std::vector<std::string> tcp = split(tcp_protocol);
+  if (tcp.empty() || flows == 0 || stagger < 0 ||
+      start_time + (flows - 1) * stagger >= stop_time) {
+    NS_LOG_UNCOND("Need at least one flow, TCP protocol, and stop after "
+                  "last flow starts (start + (flows-1) * stagger).");
+    return 1;
+  }
+  for (size_t i = 0; i < tcp.size(); i++) {
+    TypeId tid;
+    if (!TypeId::LookupByNameFailSafe(tcp[i], &tid)) {
+      NS_LOG_UNCOND("Unknown TCP protocol: " << tcp[i]);
+      return 1;
+    }
+  }
+
   /////////////////////////////////////////
   // Turn on logging for this script.
   // Note: for BBR', other components that may be
@@ -58,70 +144,91 @@ int main (int argc, char *argv[]) {
   /////////////////////////////////////////
   // Setup environment
   Config::SetDefault("ns3::TcpL4Protocol::SocketType",
-                     StringValue(TCP_PROTOCOL));
+                     StringValue(tcp[0]));
 
   // Report parameters.
-  NS_LOG_INFO("TCP protocol: " << TCP_PROTOCOL);
-  NS_LOG_INFO("Server to Router Bwdth: " << S_TO_R_BW);
-  NS_LOG_INFO("Server to Router Delay: " << S_TO_R_DELAY);
-  NS_LOG_INFO("Router to Client Bwdth: " << R_TO_C_BW);
-  NS_LOG_INFO("Router to Client Delay: " << R_TO_C_DELAY);
-  NS_LOG_INFO("Packet size (bytes): " << PACKET_SIZE);
-  
+  NS_LOG_INFO("TCP protocol: " << tcp_protocol);
+  NS_LOG_INFO("Flows: " << flows << "  Stagger (s): " << stagger);
+  NS_LOG_INFO("Server to Router Bwdth: " << s_to_r_bw);
+  NS_LOG_INFO("Server to Router Delay: " << s_to_r_delay);
+  NS_LOG_INFO("Router to Client Bwdth: " << r_to_c_bw);
+  NS_LOG_INFO("Router to Client Delay: " << r_to_c_delay);
+  NS_LOG_INFO("Packet size (bytes): " << packet_size);
+
   // Set segment size (otherwise, ns-3 default is 536).
   Config::SetDefault("ns3::TcpSocket::SegmentSize",
-                     UintegerValue(PACKET_SIZE)); 
+                     UintegerValue(packet_size));
 
   // Turn off delayed ack (so, acks every packet).
   // Note, BBR' still works without this.
   Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(0));
-   
+
   /////////////////////////////////////////
   // Create nodes.
   NS_LOG_INFO("Creating nodes.");
-  NodeContainer nodes;  // 0=source, 1=router, 2=sink
-  nodes.Create(3);
-
-  /////////////////////////////////////////
-  // Create channels.
-  NS_LOG_INFO("Creating channels.");
-  NodeContainer n0_to_r = NodeContainer(nodes.Get(0), nodes.Get(1));
-  NodeContainer r_to_n1 = NodeContainer(nodes.Get(1), nodes.Get(2));
+  NodeContainer senders;  // One per flow.
+  senders.Create(flows);
+  NodeContainer nodes;    // 0=router, 1=sink
+  nodes.Create(2);
+  Ptr<Node> router = nodes.Get(0);
+  Ptr<Node> client = nodes.Get(1);
 
   /////////////////////////////////////////
   // Create links.
   NS_LOG_INFO("Creating links.");
 
-  // Server to Router.
+  // Servers to Router.
   int mtu = 1500;
   PointToPointHelper p2p;
-  p2p.SetDeviceAttribute("DataRate", StringValue (S_TO_R_BW));
-  p2p.SetChannelAttribute("Delay", StringValue (S_TO_R_DELAY));
+  p2p.SetDeviceAttribute("DataRate", StringValue (s_to_r_bw));
+  p2p.SetChannelAttribute("Delay", StringValue (s_to_r_delay));
   p2p.SetDeviceAttribute ("Mtu", UintegerValue(mtu));
-  NetDeviceContainer devices1 = p2p.Install(n0_to_r);
+  std::vector<NetDeviceContainer> devices1;
+  for (uint32_t i = 0; i < flows; i++)
+    devices1.push_back(p2p.Install(senders.Get(i), router));
 
   // Router to Client.
-  p2p.SetDeviceAttribute("DataRate", StringValue (R_TO_C_BW));
-  p2p.SetChannelAttribute("Delay", StringValue (R_TO_C_DELAY));
+  p2p.SetDeviceAttribute("DataRate", StringValue (r_to_c_bw));
+  p2p.SetChannelAttribute("Delay", StringValue (r_to_c_delay));
   p2p.SetDeviceAttribute ("Mtu", UintegerValue(mtu));
-  NS_LOG_INFO("Router queue size: "<< QUEUE_SIZE);
+  NS_LOG_INFO("Router queue size: "<< queue_size);
   p2p.SetQueue("ns3::DropTailQueue",
                "Mode", StringValue ("QUEUE_MODE_PACKETS"),
-               "MaxPackets", UintegerValue(QUEUE_SIZE));
-  NetDeviceContainer devices2 = p2p.Install(r_to_n1);
+               "MaxPackets", UintegerValue(queue_size));
+  NetDeviceContainer devices2 = p2p.Install(router, client);
 
   /////////////////////////////////////////
   // Install Internet stack.
   NS_LOG_INFO("Installing Internet stack.");
   InternetStackHelper internet;
+  internet.Install(senders);
   internet.Install(nodes);
-  
+
+  // Congestion control per sender (sockets made from node's type).
+  for (uint32_t i = 0; i < flows; i++) {
+    std::string type = tcp[i % tcp.size()];
+    senders.Get(i) -> GetObject<TcpL4Protocol>() ->
+      SetAttribute("SocketType", TypeIdValue(TypeId::LookupByName(type)));
+  }
+
+  // Router queue disc (before addresses, so not ns-3 default).
+  if (!queue_disc.empty()) {
+    NS_LOG_INFO("Router queue disc: " << queue_disc);
+    TrafficControlHelper tch;
+    tch.SetRootQueueDisc(queue_disc);
+    tch.Install(devices2.Get(0));
+  }
+
   /////////////////////////////////////////
   // Add IP addresses.
   NS_LOG_INFO("Assigning IP Addresses.");
   Ipv4AddressHelper ipv4;
-  ipv4.SetBase("10.1.1.0", "255.255.255.0");
-  Ipv4InterfaceContainer i0i1 = ipv4.Assign(devices1);
+  for (uint32_t i = 0; i < flows; i++) {
+    std::ostringstream subnet;
+    subnet << "10." << 1 + i / 250 << "." << 1 + i % 250 << ".0";
+    ipv4.SetBase(subnet.str().c_str(), "255.255.255.0");
+    ipv4.Assign(devices1[i]);
+  }
 
   ipv4.SetBase("191.168.1.0", "255.255.255.0");
   Ipv4InterfaceContainer i1i2 = ipv4.Assign(devices2);
@@ -133,60 +240,98 @@ int main (int argc, char *argv[]) {
   NS_LOG_INFO("Creating applications.");
   NS_LOG_INFO("  Bulk send.");
 
-  // Well-known port for server.
-  uint16_t port = 911;  
-
-  // Source (at node 0).
-  BulkSendHelper source("ns3::TcpSocketFactory",
-                        InetSocketAddress(i1i2.GetAddress(1), port));
-  // Set the amount of data to send in bytes (0 for unlimited).
-  source.SetAttribute("MaxBytes", UintegerValue(0));
-  source.SetAttribute("SendSize", UintegerValue(PACKET_SIZE));
-  ApplicationContainer apps = source.Install(nodes.Get(0));
-  apps.Start(Seconds(START_TIME));
-  apps.Stop(Seconds(STOP_TIME));
-
-  // Sink (at node 2).
-  PacketSinkHelper sink("ns3::TcpSocketFactory",
-                        InetSocketAddress(Ipv4Address::GetAny(), port));
-  apps = sink.Install(nodes.Get(2));
-  apps.Start(Seconds(START_TIME));
-  apps.Stop(Seconds(STOP_TIME));
-  Ptr<PacketSink> p_sink = DynamicCast<PacketSink> (apps.Get(0)); // 4 stats
+  // Well-known port for server (one per flow from here).
+  uint16_t port = 911;
+
+  std::vector<Ptr<BulkSendApplication> > sources;
+  std::vector<Ptr<PacketSink> > sinks;   // 4 stats
+  std::vector<double> starts;
+  for (uint32_t i = 0; i < flows; i++) {
+    double start = start_time + i * stagger;
+    starts.push_back(start);
+
+    // Source (at sender i).
+    BulkSendHelper source("ns3::TcpSocketFactory",
+                          InetSocketAddress(i1i2.GetAddress(1), port + i));
+    // Set the amount of data to send in bytes (0 for unlimited).
+    source.SetAttribute("MaxBytes", UintegerValue(0));
+    source.SetAttribute("SendSize", UintegerValue(packet_size));
+    ApplicationContainer apps = source.Install(senders.Get(i));
+    apps.Start(Seconds(start));
+    apps.Stop(Seconds(stop_time));
+    sources.push_back(DynamicCast<BulkSendApplication> (apps.Get(0)));
+
+    // Sink (at client).
+    PacketSinkHelper sink("ns3::TcpSocketFactory",
+                          InetSocketAddress(Ipv4Address::GetAny(), port + i));
+    apps = sink.Install(client);
+    apps.Start(Seconds(start_time));
+    apps.Stop(Seconds(stop_time));
+    sinks.push_back(DynamicCast<PacketSink> (apps.Get(0)));
+  }
 
   /////////////////////////////////////////
   // Setup tracing (as appropriate).
-  if (ENABLE_TRACE) {
+  if (enable_trace) {
     NS_LOG_INFO("Enabling trace files.");
     AsciiTraceHelper ath;
-    p2p.EnableAsciiAll(ath.CreateFileStream("trace.tr"));
-  }  
-  if (ENABLE_PCAP) {
+    p2p.EnableAsciiAll(ath.CreateFileStream(output + "/trace.tr"));
+  }
+  if (enable_pcap) {
     NS_LOG_INFO("Enabling pcap files.");
-    p2p.EnablePcapAll("shark", true);
+    p2p.EnablePcapAll(output + "/shark", true);
+  }
+  Ptr<BbrRecorder> recorder;
+  if (enable_record) {
+    NS_LOG_INFO("Enabling record file.");
+    recorder = CreateObject<BbrRecorder>();
+    if (!recorder -> Open(output + "/bulk.rec"))
+      NS_LOG_UNCOND("Can't open record file in: " << output);
+
+    // Socket made when application starts, so record just after.
+    for (uint32_t i = 0; i < flows; i++)
+      Simulator::Schedule(Seconds(starts[i]) + NanoSeconds(1),
+                          &recordFlow, recorder, sources[i]);
   }
 
   /////////////////////////////////////////
   // Run simulation.
   NS_LOG_INFO("Running simulation.");
-  Simulator::Stop(Seconds(STOP_TIME));
-  NS_LOG_INFO("Simulation time: [" << 
-              START_TIME << "," <<
-              STOP_TIME << "]");
+  Simulator::Stop(Seconds(stop_time));
+  NS_LOG_INFO("Simulation time: [" <<
+              start_time << "," <<
+              stop_time << "]");
   NS_LOG_INFO("---------------- Start -----------------------");
   Simulator::Run();
   NS_LOG_INFO("---------------- Stop ------------------------");
 
   /////////////////////////////////////////
   // Ouput stats.
-  NS_LOG_INFO("Total bytes received: " << p_sink->GetTotalRx());
-  double tput = p_sink->GetTotalRx() / (STOP_TIME - START_TIME);
+  uint64_t total = 0;
+  std::ostringstream flow_tput;
+  for (uint32_t i = 0; i < flows; i++) {
+    uint64_t rx = sinks[i]->GetTotalRx();
+    total += rx;
+    double tput = rx / (stop_time - starts[i]);
+    tput *= 8;          // Convert to bits.
+    tput /= 1000000.0;  // Convert to Mb/s
+    flow_tput << "," << tput;
+    if (flows > 1)
+      NS_LOG_INFO("Flow " << i << " (" << tcp[i % tcp.size()] << "): " <<
+                  rx << " bytes, " << tput << " Mb/s");
+  }
+  NS_LOG_INFO("Total bytes received: " << total);
+  double tput = total / (stop_time - start_time);
   tput *= 8;          // Convert to bits.
   tput /= 1000000.0;  // Convert to Mb/s
   NS_LOG_INFO("Throughput: " << tput << " Mb/s");
+  if (csv)
+    std::cout << flows << "," << total << "," << tput << flow_tput.str() << std::endl;
   NS_LOG_INFO("Done.");
 
   // Done.
+  if (recorder)
+    recorder -> Close();
   Simulator::Destroy();
   return 0;
 }
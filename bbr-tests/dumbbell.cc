@@ -0,0 +1,352 @@
+//
+// Network topology (dumbbell)
+//
+//       s0 ---\                                 /--- c0
+//       s1 ----- (r0) ------ bottleneck ------ (r1) ---- c1
+//       ...   /     12.1.1.1          12.1.1.2     \   ...
+//       s(N-1)                                      c(N-1)
+//         10.x.x.x                          11.x.x.x
+//
+// - N flows (default 4), flow i from sender si to client ci using
+//   BulkSendApplication, with congestion control cycled from --tcp
+//   list (default mix of BBR' and NewReno) and access link delay
+//   cycled from --accessDelay list (for RTT fairness).
+//
+// - Reports per-flow throughput, Jain's fairness index, bottleneck
+//   queue delay percentiles and bottleneck loss rate.  All are
+//   measured after --warmup, so the flows have time to converge (all
+//   flows must start, staggered by --stagger, before warmup ends).
+//
+// - The bottleneck queue is the router's device queue (drop tail, no
+//   queue disc above it), so all queueing is measured there.
+//
+//     ./waf --run "dumbbell --flows=8 --accessDelay=5ms,20ms,40ms"
+//
+
+// System includes.
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// NS3 includes.
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/packet-sink.h"
+#include "ns3/ipv4-global-routing-helper.h"
+
+using namespace ns3;
+
+// For logging.
+
+NS_LOG_COMPONENT_DEFINE ("main");
+
+// Bottleneck queue statistics.
+struct queue_stats {
+  std::deque<Time> enqueued;   // Enqueue times of packets in queue (FIFO).
+  std::vector<double> delay;   // Queue delay of each packet (ms).
+  uint64_t packets;            // Packets enqueued.
+  uint64_t drops;              // Packets dropped.
+};
+queue_stats g_queue;
+
+// Packet enqueued at bottleneck.
+void enqueueTrace(Ptr<const Packet> p) {
+  g_queue.enqueued.push_back(Simulator::Now());
+  g_queue.packets++;
+}
+
+// Packet dequeued at bottleneck (FIFO, so oldest enqueued).
+void dequeueTrace(Ptr<const Packet> p) {
+  if (g_queue.enqueued.empty())
+    return;
+  Time delay = Simulator::Now() - g_queue.enqueued.front();
+  g_queue.enqueued.pop_front();
+  g_queue.delay.push_back(delay.GetSeconds() * 1000);
+}
+
+// Packet dropped at bottleneck (drop tail, so never enqueued).
+void dropTrace(Ptr<const Packet> p) {
+  g_queue.drops++;
+}
+
+// Split comma-separated list.
+std::vector<std::string> split(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return items;
+}
+
+// Return subnet for flow i (up to 250 per third octet).
+std::string subnet(int first, uint32_t i) {
+  std::ostringstream ss;
+  ss << first << "." << 1 + i / 250 << "." << 1 + i % 250 << ".0";
+  return ss.str();
+}
+
+// Return p-th percentile (0-100) of values (sorted).
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  size_t i = (size_t) (p / 100 * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+// At end of warmup, save bytes received by each sink and reset
+// queue statistics, so all metrics are over the measured interval.
+// Packets in queue keep their enqueue times.
+void snapshot(std::vector<Ptr<PacketSink> > *sinks,
+              std::vector<uint64_t> *rx) {
+  for (size_t i = 0; i < sinks -> size(); i++)
+    (*rx)[i] = (*sinks)[i] -> GetTotalRx();
+  g_queue.delay.clear();
+  g_queue.packets = 0;
+  g_queue.drops = 0;
+}
+
+/////////////////////////////////////////////////
+int main (int argc, char *argv[]) {
+
+  /////////////////////////////////////////
+  // Defaults (overridden by command line).
+  uint32_t flows = 4;
+  std::string tcp_protocol = "ns3::TcpBbr,ns3::TcpNewReno";
+  std::string access_bw = "1Gbps";       // Sender/client to router
+  std::string access_delay = "10ms";     // List, cycled over flows
+  std::string bottleneck_bw = "100Mbps";
+  std::string bottleneck_delay = "5ms";
+  uint32_t queue_size = 500;             // Packets
+  uint32_t packet_size = 1000;           // Bytes.
+  double stagger = 0.0;                  // Seconds between flow starts
+  double warmup = 5.0;                   // Seconds not measured
+  double stop_time = 30.0;               // Seconds
+
+  CommandLine cmd;
+  cmd.AddValue("flows", "Number of flows (sender/client pairs)", flows);
+  cmd.AddValue("tcp",
+               "TCP congestion control, comma-separated list "
+               "cycled over flows", tcp_protocol);
+  cmd.AddValue("accessBw", "Access link bandwidth", access_bw);
+  cmd.AddValue("accessDelay",
+               "Sender access link delay, comma-separated list "
+               "cycled over flows", access_delay);
+  cmd.AddValue("bottleneckBw", "Bottleneck bandwidth", bottleneck_bw);
+  cmd.AddValue("bottleneckDelay", "Bottleneck delay", bottleneck_delay);
+  cmd.AddValue("queueSize", "Bottleneck queue size (packets)", queue_size);
+  cmd.AddValue("packetSize", "Packet (segment) size (bytes)", packet_size);
+  cmd.AddValue("stagger", "Time between flow starts (seconds)", stagger);
+  cmd.AddValue("warmup", "Time before metrics measured (seconds)", warmup);
+  cmd.AddValue("stop", "Stop time (seconds)", stop_time);
+  cmd.Parse(argc, argv);
+
+  std::vector<std::string> tcp = split(tcp_protocol);
+  std::vector<std::string> delays = split(access_delay);
+  if (tcp.empty() || delays.empty() || flows == 0 || stop_time <= warmup ||
+      stagger < 0 || (flows - 1) * stagger >= warmup) {
+    NS_LOG_UNCOND("Need at least one flow, TCP protocol, delay, stop after "
+                  "warmup, and last flow start ((flows-1) * stagger) before "
+                  "warmup.");
+    return 1;
+  }
+  for (size_t i = 0; i < tcp.size(); i++) {
+    TypeId tid;
+    if (!TypeId::LookupByNameFailSafe(tcp[i], &tid)) {
+      NS_LOG_UNCOND("Unknown TCP protocol: " << tcp[i]);
+      return 1;
+    }
+  }
+
+  /////////////////////////////////////////
+  // Turn on logging for this script.
+  LogComponentEnable("main", LOG_LEVEL_INFO);
+
+  /////////////////////////////////////////
+  // Setup environment
+
+  // Report parameters.
+  NS_LOG_INFO("Flows: " << flows << "  TCP protocol: " << tcp_protocol);
+  NS_LOG_INFO("Access Bwdth: " << access_bw << "  Delay: " << access_delay);
+  NS_LOG_INFO("Bottleneck Bwdth: " << bottleneck_bw <<
+              "  Delay: " << bottleneck_delay);
+  NS_LOG_INFO("Bottleneck queue size: " << queue_size);
+  NS_LOG_INFO("Packet size (bytes): " << packet_size);
+
+  // Set segment size (otherwise, ns-3 default is 536).
+  Config::SetDefault("ns3::TcpSocket::SegmentSize",
+                     UintegerValue(packet_size));
+
+  // Turn off delayed ack (so, acks every packet).
+  Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(0));
+
+  // Large buffers, so cwnd is the limit (see README, Buffer Limits).
+  Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(1 << 24));
+  Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(1 << 24));
+
+  /////////////////////////////////////////
+  // Create nodes.
+  NS_LOG_INFO("Creating nodes.");
+  NodeContainer senders, clients, routers;
+  senders.Create(flows);
+  clients.Create(flows);
+  routers.Create(2);
+
+  /////////////////////////////////////////
+  // Create links.
+  NS_LOG_INFO("Creating links.");
+  int mtu = 1500;
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("Mtu", UintegerValue(mtu));
+
+  // Bottleneck.
+  p2p.SetDeviceAttribute("DataRate", StringValue (bottleneck_bw));
+  p2p.SetChannelAttribute("Delay", StringValue (bottleneck_delay));
+  p2p.SetQueue("ns3::DropTailQueue",
+               "Mode", StringValue ("QUEUE_MODE_PACKETS"),
+               "MaxPackets", UintegerValue(queue_size));
+  NetDeviceContainer bottleneck = p2p.Install(routers.Get(0), routers.Get(1));
+
+  // Access links (senders and clients).
+  p2p.SetDeviceAttribute("DataRate", StringValue (access_bw));
+  p2p.SetQueue("ns3::DropTailQueue",
+               "Mode", StringValue ("QUEUE_MODE_PACKETS"),
+               "MaxPackets", UintegerValue(queue_size));
+  std::vector<NetDeviceContainer> left, right;
+  for (uint32_t i = 0; i < flows; i++) {
+    p2p.SetChannelAttribute("Delay", StringValue (delays[i % delays.size()]));
+    left.push_back(p2p.Install(senders.Get(i), routers.Get(0)));
+    p2p.SetChannelAttribute("Delay", StringValue ("0ms"));
+    right.push_back(p2p.Install(routers.Get(1), clients.Get(i)));
+  }
+
+  /////////////////////////////////////////
+  // Install Internet stack.
+  NS_LOG_INFO("Installing Internet stack.");
+  InternetStackHelper internet;
+  internet.Install(senders);
+  internet.Install(clients);
+  internet.Install(routers);
+
+  // Congestion control per sender (sockets made from node's type).
+  for (uint32_t i = 0; i < flows; i++) {
+    std::string type = tcp[i % tcp.size()];
+    senders.Get(i) -> GetObject<TcpL4Protocol>() ->
+      SetAttribute("SocketType", TypeIdValue(TypeId::LookupByName(type)));
+  }
+
+  /////////////////////////////////////////
+  // Add IP addresses.
+  NS_LOG_INFO("Assigning IP Addresses.");
+  Ipv4AddressHelper ipv4;
+  std::vector<Ipv4Address> client_address;
+  for (uint32_t i = 0; i < flows; i++) {
+    ipv4.SetBase(subnet(10, i).c_str(), "255.255.255.0");
+    ipv4.Assign(left[i]);
+    ipv4.SetBase(subnet(11, i).c_str(), "255.255.255.0");
+    client_address.push_back(ipv4.Assign(right[i]).GetAddress(1));
+  }
+  ipv4.SetBase("12.1.1.0", "255.255.255.0");
+  ipv4.Assign(bottleneck);
+
+  // No queue disc at bottleneck, so device queue is the only queue.
+  TrafficControlHelper tch;
+  tch.Uninstall(bottleneck.Get(0));
+
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+
+  /////////////////////////////////////////
+  // Create apps.
+  NS_LOG_INFO("Creating applications.");
+  uint16_t port = 911;
+  std::vector<Ptr<PacketSink> > sinks;
+  for (uint32_t i = 0; i < flows; i++) {
+
+    // Source (at sender i).
+    BulkSendHelper source("ns3::TcpSocketFactory",
+                          InetSocketAddress(client_address[i], port));
+    source.SetAttribute("MaxBytes", UintegerValue(0));
+    source.SetAttribute("SendSize", UintegerValue(packet_size));
+    ApplicationContainer apps = source.Install(senders.Get(i));
+    apps.Start(Seconds(i * stagger));
+    apps.Stop(Seconds(stop_time));
+
+    // Sink (at client i).
+    PacketSinkHelper sink("ns3::TcpSocketFactory",
+                          InetSocketAddress(Ipv4Address::GetAny(), port));
+    apps = sink.Install(clients.Get(i));
+    apps.Start(Seconds(0.0));
+    apps.Stop(Seconds(stop_time));
+    sinks.push_back(DynamicCast<PacketSink> (apps.Get(0)));
+  }
+
+  /////////////////////////////////////////
+  // Setup bottleneck queue tracing.
+  Ptr<PointToPointNetDevice> dev =
+    DynamicCast<PointToPointNetDevice>(bottleneck.Get(0));
+  Ptr<Queue<Packet> > queue = dev -> GetQueue();
+  queue -> TraceConnectWithoutContext("Enqueue", MakeCallback(&enqueueTrace));
+  queue -> TraceConnectWithoutContext("Dequeue", MakeCallback(&dequeueTrace));
+  queue -> TraceConnectWithoutContext("Drop", MakeCallback(&dropTrace));
+
+  // Bytes received at end of warmup.
+  std::vector<uint64_t> warm_rx(flows, 0);
+  Simulator::Schedule(Seconds(warmup), &snapshot, &sinks, &warm_rx);
+
+  /////////////////////////////////////////
+  // Run simulation.
+  NS_LOG_INFO("Running simulation.");
+  Simulator::Stop(Seconds(stop_time));
+  NS_LOG_INFO("Simulation time: [0," << stop_time << "]  " <<
+              "Measured: [" << warmup << "," << stop_time << "]");
+  NS_LOG_INFO("---------------- Start -----------------------");
+  Simulator::Run();
+  NS_LOG_INFO("---------------- Stop ------------------------");
+
+  /////////////////////////////////////////
+  // Ouput stats.
+
+  NS_LOG_INFO("Measured interval (all metrics): [" << warmup << "," <<
+              stop_time << "] sec");
+
+  // Per-flow throughput and Jain's fairness index:
+  //   (sum x_i)^2 / (n * sum x_i^2)
+  double sum = 0, sum_sq = 0;
+  for (uint32_t i = 0; i < flows; i++) {
+    double tput = (sinks[i]->GetTotalRx() - warm_rx[i]) / (stop_time - warmup);
+    tput *= 8;          // Convert to bits.
+    tput /= 1000000.0;  // Convert to Mb/s
+    sum += tput;
+    sum_sq += tput * tput;
+    NS_LOG_INFO("Flow " << i << " (" << tcp[i % tcp.size()] << ", " <<
+                delays[i % delays.size()] << "): " << tput << " Mb/s");
+  }
+  double jain = (sum_sq > 0) ? sum * sum / (flows * sum_sq) : 0;
+  NS_LOG_INFO("Throughput: " << sum << " Mb/s");
+  NS_LOG_INFO("Jain's fairness index: " << jain);
+
+  // Bottleneck queue delay percentiles and loss rate.
+  std::vector<double> &delay = g_queue.delay;
+  std::sort(delay.begin(), delay.end());
+  NS_LOG_INFO("Queue delay (ms):" <<
+              "  p50: " << percentile(delay, 50) <<
+              "  p90: " << percentile(delay, 90) <<
+              "  p99: " << percentile(delay, 99) <<
+              "  max: " << (delay.empty() ? 0 : delay.back()));
+  uint64_t offered = g_queue.packets + g_queue.drops;
+  double loss = offered ? (double) g_queue.drops / offered : 0;
+  NS_LOG_INFO("Loss rate: " << loss * 100 << "% (" <<
+              g_queue.drops << " of " << offered << " packets)");
+  NS_LOG_INFO("Done.");
+
+  // Done.
+  Simulator::Destroy();
+  return 0;
+}
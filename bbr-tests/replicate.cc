@@ -0,0 +1,297 @@
+//
+// Parallel replicate runner for independent simulations.
+//
+// - Runs a simulation program (default bulk, next to this program)
+//   once per parameter tuple (line of --params file, or none) and run
+//   number 1..--runs, passing "--RngRun=<run>", so each replicate has
+//   independent random streams.
+//
+// - Up to --jobs (default number of cores) run at once, each its own
+//   process pinned to its own core (Linux).
+//
+// - Stdout of each job (e.g., "bulk --csv" summary) goes to
+//   <output>/job-<hash>-<run>.out, stderr to job-<hash>-<run>.log,
+//   where hash is of the tuple text.  Completed jobs (run and tuple
+//   text) are added to <output>/checkpoint, so a re-run with the same
+//   --output skips them, even if the params file was edited (failed
+//   jobs are re-run).  When all are done, <output>/results.csv has the
+//   stdout of every completed job of the params file, in order, each
+//   line prefixed by tuple (quoted) and run number.
+//
+//     ./waf --run "replicate --params=matrix.txt --runs=30 --output=study1"
+//
+//   With matrix.txt, e.g.:
+//
+//     --csv --flows=1 --bottleneckBw=10Mbps
+//     --csv --flows=4 --bottleneckBw=50Mbps --tcp=ns3::TcpBbr,ns3::TcpNewReno
+//
+
+// System includes.
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// NS3 includes.
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+// One simulation to run.
+struct job {
+  uint32_t tuple;          // Parameter tuple (index in tuples read).
+  uint32_t run;            // RngRun.
+  int core;                // Core pinned to (while running).
+};
+
+// Completed job: tuple text and run.
+typedef std::pair<std::string, uint32_t> job_key;
+
+// Return hash of tuple text (64-bit FNV-1a, so same across builds).
+uint64_t tupleHash(const std::string &tuple) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < tuple.size(); i++) {
+    hash ^= (unsigned char) tuple[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Return job file name (without suffix), from tuple text and run, so
+// doesn't depend on line of params file.
+std::string jobName(const std::string &output, const std::string &tuple,
+                    uint32_t run) {
+  std::ostringstream ss;
+  ss << output << "/job-" << std::hex << std::setw(16) << std::setfill('0')
+     << tupleHash(tuple) << std::dec << "-" << run;
+  return ss.str();
+}
+
+// Return tuple quoted for CSV (quotes doubled).
+std::string csvQuote(const std::string &tuple) {
+  std::string quoted = "\"";
+  for (size_t i = 0; i < tuple.size(); i++) {
+    if (tuple[i] == '"')
+      quoted += '"';
+    quoted += tuple[i];
+  }
+  return quoted + "\"";
+}
+
+// Return default program: bulk, in same directory and with same
+// ns-3 prefix/suffix (e.g., ns3.27-bulk-debug) as this program.
+std::string defaultProgram(const std::string &self) {
+  std::string program = self;
+  size_t i = program.rfind("replicate");
+  if (i != std::string::npos)
+    program.replace(i, std::string("replicate").size(), "bulk");
+  return program;
+}
+
+// Start job in child process, pinned to core, with output to files.
+// Return child pid (-1 if can't).
+pid_t start(const std::string &program, const std::string &tuple,
+            const std::string &output, const job &j) {
+  pid_t pid = fork();
+  if (pid != 0)
+    return pid;
+
+  // Child.
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(j.core, &cpus);
+  sched_setaffinity(0, sizeof(cpus), &cpus);
+#endif
+  std::string name = jobName(output, tuple, j.run);
+  int out = open((name + ".out").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  int err = open((name + ".log").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out < 0 || err < 0)
+    _exit(127);
+  dup2(out, STDOUT_FILENO);
+  dup2(err, STDERR_FILENO);
+  close(out);
+  close(err);
+
+  // Arguments: tuple (whitespace separated), then run.
+  std::vector<std::string> args;
+  args.push_back(program);
+  std::istringstream ss(tuple);
+  std::string arg;
+  while (ss >> arg)
+    args.push_back(arg);
+  std::ostringstream run;
+  run << "--RngRun=" << j.run;
+  args.push_back(run.str());
+
+  std::vector<char *> argv;
+  for (size_t i = 0; i < args.size(); i++)
+    argv.push_back(const_cast<char *>(args[i].c_str()));
+  argv.push_back(NULL);
+  execv(program.c_str(), &argv[0]);
+  _exit(127);  // Exec failed.
+}
+
+// Read completed jobs from checkpoint, one per line: run, space,
+// then tuple text (rest of line).
+std::set<job_key> readCheckpoint(const std::string &file) {
+  std::set<job_key> done;
+  std::ifstream in(file.c_str());
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t space = line.find(' ');
+    if (space == std::string::npos)
+      continue;
+    uint32_t run = std::strtoul(line.substr(0, space).c_str(), NULL, 10);
+    done.insert(std::make_pair(line.substr(space + 1), run));
+  }
+  return done;
+}
+
+/////////////////////////////////////////////////
+int main (int argc, char *argv[]) {
+
+  /////////////////////////////////////////
+  // Defaults (overridden by command line).
+  std::string program = defaultProgram(argv[0]);
+  std::string params = "";               // File, one tuple per line.
+  std::string output = "replicate";      // Directory for output files.
+  uint32_t runs = 10;                    // RngRun 1..runs per tuple.
+  uint32_t jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t first_core = 0;
+
+  CommandLine cmd;
+  cmd.AddValue("program", "Simulation program to run", program);
+  cmd.AddValue("params",
+               "Parameter tuples file, one line of program options per "
+               "tuple (\"\" for one, empty tuple)", params);
+  cmd.AddValue("runs", "Runs (RngRun 1..runs) per tuple", runs);
+  cmd.AddValue("jobs", "Jobs to run at once (one per core)", jobs);
+  cmd.AddValue("firstCore", "First core to pin jobs to", first_core);
+  cmd.AddValue("output", "Directory for output files", output);
+  cmd.Parse(argc, argv);
+
+  // Tuples (skipping blank lines, comments and duplicates).
+  std::vector<std::string> tuples;
+  if (params.empty())
+    tuples.push_back("");
+  else {
+    std::ifstream in(params.c_str());
+    if (!in) {
+      std::cerr << "Can't read params file: " << params << std::endl;
+      return 1;
+    }
+    std::string line;
+    while (std::getline(in, line))
+      if (line.find_first_not_of(" \t") != std::string::npos && line[0] != '#' &&
+          std::find(tuples.begin(), tuples.end(), line) == tuples.end())
+        tuples.push_back(line);
+  }
+  if (jobs == 0)
+    jobs = 1;
+  mkdir(output.c_str(), 0755);
+
+  // Jobs not yet done (per checkpoint).
+  std::string checkpoint_file = output + "/checkpoint";
+  std::set<job_key> done = readCheckpoint(checkpoint_file);
+  std::vector<job> todo;
+  uint32_t already = 0;
+  for (uint32_t t = 0; t < tuples.size(); t++)
+    for (uint32_t r = 1; r <= runs; r++)
+      if (done.find(std::make_pair(tuples[t], r)) != done.end())
+        already++;
+      else {
+        job j = {t, r, -1};
+        todo.push_back(j);
+      }
+  std::cerr << "Program: " << program << std::endl;
+  std::cerr << "Jobs: " << todo.size() << " to run, " << already
+            << " already done, " << jobs << " at once" << std::endl;
+
+  /////////////////////////////////////////
+  // Run jobs, up to jobs at once, each on free core.
+  std::ofstream checkpoint(checkpoint_file.c_str(), std::ios::out | std::ios::app);
+  std::map<pid_t, job> running;
+  std::vector<bool> busy(jobs, false);
+  size_t next = 0;
+  uint32_t failed = 0;
+  while (next < todo.size() || !running.empty()) {
+
+    // Start jobs on free cores.
+    for (uint32_t slot = 0; slot < jobs && next < todo.size(); slot++) {
+      if (busy[slot])
+        continue;
+      job j = todo[next++];
+      j.core = first_core + slot;
+      pid_t pid = start(program, tuples[j.tuple], output, j);
+      if (pid < 0) {
+        std::cerr << "Can't start job: "
+                  << jobName(output, tuples[j.tuple], j.run) << std::endl;
+        failed++;
+        continue;
+      }
+      busy[slot] = true;
+      running[pid] = j;
+    }
+
+    // Nothing running (all starts failed), so start more, if any.
+    if (running.empty())
+      continue;
+
+    // Wait for any job to finish.
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "Can't wait for jobs: " << strerror(errno) << std::endl;
+      break;
+    }
+    std::map<pid_t, job>::iterator it = running.find(pid);
+    if (it == running.end())
+      continue;
+    job j = it -> second;
+    running.erase(it);
+    busy[j.core - first_core] = false;
+
+    // Checkpoint completed job (output file already written).
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+      checkpoint << j.run << " " << tuples[j.tuple] << std::endl;
+      done.insert(std::make_pair(tuples[j.tuple], j.run));
+    } else {
+      std::cerr << "Job failed: " << jobName(output, tuples[j.tuple], j.run)
+                << " (see .log)" << std::endl;
+      failed++;
+    }
+  }
+
+  /////////////////////////////////////////
+  // Aggregate output of completed jobs, in order.
+  std::string results_file = output + "/results.csv";
+  std::ofstream results(results_file.c_str(), std::ios::out | std::ios::trunc);
+  for (uint32_t t = 0; t < tuples.size(); t++)
+    for (uint32_t r = 1; r <= runs; r++) {
+      if (done.find(std::make_pair(tuples[t], r)) == done.end())
+        continue;
+      std::ifstream in((jobName(output, tuples[t], r) + ".out").c_str());
+      std::string line;
+      while (std::getline(in, line))
+        results << csvQuote(tuples[t]) << "," << r << "," << line << std::endl;
+    }
+  std::cerr << "Results: " << results_file << "  Failed: " << failed << std::endl;
+
+  return failed ? 1 : 0;
+}
@@ -81,11 +81,6 @@ BulkSendApplication::BulkSendApplication ()
     m_pacing_event ()           // For pacing
 {
   NS_LOG_FUNCTION (this);
-
-  if (PACING_CONFIG == APP_PACING)
-    NS_LOG_INFO ("APP_PACING. No pacing in TCP. This app *will do* pacing.");
-  else
-    NS_LOG_INFO ("This application will *not* do pacing.");
 }
 
 BulkSendApplication::~BulkSendApplication ()
@@ -158,6 +153,12 @@ void BulkSendApplication::StartApplication (void) // Called at time specified by
         MakeCallback (&BulkSendApplication::ConnectionFailed, this));
       m_socket->SetSendCallback (
         MakeCallback (&BulkSendApplication::DataSend, this));
+
+      // Pacing configuration is TCP socket attribute.
+      if (GetPacingConfig () == APP_PACING)
+        NS_LOG_INFO ("APP_PACING. No pacing in TCP. This app *will do* pacing.");
+      else
+        NS_LOG_INFO ("This application will *not* do pacing.");
     }
   if (m_connected)
     {
@@ -191,7 +192,7 @@ void BulkSendApplication::SendData (void)
     { // Time to send more
 
       // IF APPLICATION PACING
-      if (PACING_CONFIG == APP_PACING) {
+      if (GetPacingConfig() == APP_PACING) {
 
         // If no pacing rate set, normal (non-paced) code will handle.
         if (GetPacingRate() == 0.0) { 
@@ -357,6 +358,16 @@ double BulkSendApplication::GetPacingRate() const {
 
   return  tcp_socket_base -> GetPacingRate();
 }
+
+// Get pacing configuration from TCP socket base.
+enum_pacing_config BulkSendApplication::GetPacingConfig() const {
+
+  // Since must be NS3_SOCK_STREAM (TCP), get the TCP socket base.
+  TcpSocketBase *p_temp = dynamic_cast <TcpSocketBase *>(GetPointer(m_socket));
+  NS_ASSERT(p_temp != NULL);
+
+  return p_temp -> GetPacingConfig();
+}
   
 // ADDED TO SUPPORT PACING - End
 ////////////////////////////////////////////////////////
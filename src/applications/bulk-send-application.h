@@ -26,6 +26,7 @@
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
 #include "ns3/traced-callback.h"
+#include "ns3/tcp-socket-base.h" // For pacing configuration.
 
 namespace ns3 {
 
@@ -144,6 +145,9 @@ private:
   // Get pacing rate from TCP socket base.
   double GetPacingRate() const;
 
+  // Get pacing configuration from TCP socket base.
+  enum_pacing_config GetPacingConfig() const;
+
   // Send packet and set timer for subsequent send.
   void PaceSend();
 
@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef TCP_BBR_FILTER_H
+#define TCP_BBR_FILTER_H
+
+#include <functional>
+
+namespace ns3 {
+
+namespace bbr {
+
+///////////////////////////////////////////////////////////////////
+// Windowed min/max filter.
+//
+// Kathleen Nichols' algorithm for tracking the minimum (or maximum)
+// value of a data stream over a sliding window, as used by BBR in
+// Linux (lib/win_minmax.c).  Keeps the best, 2nd best and 3rd best
+// samples in the window, so both update and query are constant time
+// and constant space, no matter how many samples the window spans.
+//
+// V = sample value (e.g., Time for RTT, double for BW).
+// K = sample key, used for windowing (e.g., Time, or int rounds).
+// Better = comparison, true if first value better than second
+//          (std::less for min filter, std::greater for max filter).
+template <class V, class K, class Better>
+class WindowedFilter {
+
+ public:
+  // Constructor (filter starts empty).
+  WindowedFilter() : m_empty(true) {}
+
+  // Return true if no samples in window.
+  bool empty() const { return m_empty; }
+
+  // Return best value in window (only valid if not empty).
+  V get() const { return m_s[0].value; }
+
+  // Return key of best value in window (only valid if not empty).
+  K getKey() const { return m_s[0].key; }
+
+  // Forget all samples.
+  void clear() { m_empty = true; }
+
+  // Add new sample, value measured at key, for window of given length.
+  void update(const V &value, const K &key, const K &window) {
+    sample s = {value, key};
+
+    // New best or nothing left in window --> forget earlier samples.
+    if (m_empty ||
+        !m_better(m_s[0].value, value) ||
+        key - m_s[2].key > window) {
+      reset(s);
+      return;
+    }
+
+    if (!m_better(m_s[1].value, value))
+      m_s[2] = m_s[1] = s;
+    else if (!m_better(m_s[2].value, value))
+      m_s[2] = s;
+
+    subwindowUpdate(s, window);
+  }
+
+  // Remove samples older than window (key < now - window).
+  void expire(const K &now, const K &window) {
+    if (m_empty)
+      return;
+
+    // Nothing left in window.
+    if (now - m_s[2].key > window) {
+      m_empty = true;
+      return;
+    }
+
+    // Best choice (and maybe 2nd) too old, so promote next.
+    while (now - m_s[0].key > window) {
+      m_s[0] = m_s[1];
+      m_s[1] = m_s[2];
+    }
+  }
+
+ private:
+  // Sample stored in filter.
+  struct sample {
+    V value;
+    K key;
+  };
+
+  // Forget earlier samples, starting over with given sample.
+  void reset(const sample &s) {
+    m_s[0] = m_s[1] = m_s[2] = s;
+    m_empty = false;
+  }
+
+  // As time passes without a new best, take 2nd and 3rd choices
+  // from later sub-windows (1/4 and 1/2 of the window).
+  void subwindowUpdate(const sample &s, const K &window) {
+    K delta = s.key - m_s[0].key;
+
+    if (delta > window) {
+      // Passed entire window without new best, so 2nd choice
+      // becomes best and 3rd choice becomes 2nd.  May have to do
+      // this twice, since 2nd choice may also be outside window.
+      m_s[0] = m_s[1];
+      m_s[1] = m_s[2];
+      m_s[2] = s;
+      if (s.key - m_s[0].key > window) {
+        m_s[0] = m_s[1];
+        m_s[1] = m_s[2];
+        m_s[2] = s;
+      }
+    } else if (m_s[1].key == m_s[0].key && delta > window / 4) {
+      // Passed a quarter of window without new best, so take
+      // 2nd choice from 2nd quarter of window.
+      m_s[2] = m_s[1] = s;
+    } else if (m_s[2].key == m_s[1].key && delta > window / 2) {
+      // Passed half of window without new best, so take 3rd
+      // choice from last half of window.
+      m_s[2] = s;
+    }
+  }
+
+  sample m_s[3];             // Best, 2nd best and 3rd best samples.
+  bool m_empty;              // True if no samples in window.
+  Better m_better;           // Comparison of sample values.
+};
+
+} // end of namespace bbr
+
+} // end of namespace ns3
+
+#endif // TCP_BBR_FILTER_H
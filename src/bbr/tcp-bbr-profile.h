@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef TCP_BBR_PROFILE_H
+#define TCP_BBR_PROFILE_H
+
+#include <chrono>
+#include <stdint.h>
+
+// Hot path profiling (calls and wall-clock time), for benchmarking
+// the simulator (see bbr-tests/bench.cc).  Build with
+// -DTCP_BBR_PROFILE to enable.  Otherwise, BBR_PROFILE() is a no-op
+// and counters stay zero.
+#ifdef TCP_BBR_PROFILE
+#define BBR_PROFILE(point) ns3::bbr::ProfileTimer bbr_profile_timer(point)
+#else
+#define BBR_PROFILE(point) do { } while (false)
+#endif
+
+namespace ns3 {
+
+namespace bbr {
+
+// Profiled hot paths.
+enum profile_point {
+  PROFILE_PKTS_ACKED,      // TcpBbr::PktsAcked().
+  PROFILE_SEND,            // TcpBbr::Send().
+  PROFILE_PACE_PACKETS,    // TcpSocketBase::PacePackets() (and EDT).
+  PROFILE_POINTS           // Number of points.
+};
+
+#ifdef TCP_BBR_PROFILE
+const bool PROFILE_ENABLED = true;
+#else
+const bool PROFILE_ENABLED = false;
+#endif
+
+// Counter per profiled hot path.
+struct profile_counter {
+  uint64_t calls;          // Times called.
+  uint64_t ns;             // Total time (nanoseconds, including callees).
+};
+
+// Return counters (one per point, shared by all callers).
+inline profile_counter *profileCounters() {
+  static profile_counter counters[PROFILE_POINTS];
+  return counters;
+}
+
+// Return name of point.
+inline const char *profileName(int point) {
+  static const char *names[PROFILE_POINTS] = {
+    "pkts_acked", "send", "pace_packets"
+  };
+  return names[point];
+}
+
+// Zero all counters.
+inline void profileReset() {
+  for (int i = 0; i < PROFILE_POINTS; i++)
+    profileCounters()[i].calls = profileCounters()[i].ns = 0;
+}
+
+// Add time from construction to destruction (scope) to point.
+class ProfileTimer {
+
+ public:
+  ProfileTimer(profile_point point) :
+    m_point(point),
+    m_start(std::chrono::steady_clock::now()) {
+  }
+
+  ~ProfileTimer() {
+    profile_counter &c = profileCounters()[m_point];
+    c.calls++;
+    c.ns += std::chrono::duration_cast<std::chrono::nanoseconds>
+      (std::chrono::steady_clock::now() - m_start).count();
+  }
+
+ private:
+  profile_point m_point;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+} // end of namespace bbr
+
+} // end of namespace ns3
+
+#endif // TCP_BBR_PROFILE_H
@@ -0,0 +1,192 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// System includes.
+#include <algorithm>
+
+// BBR' includes.
+#include "tcp-bbr-rate.h"
+
+using namespace ns3;
+using namespace ns3::bbr;
+
+// Constructor.
+RateSampler::RateSampler() :
+  m_delivered(0),
+  m_delivered_time(Time(0)),
+  m_first_sent_time(Time(0)),
+  m_app_limited(0) {
+  m_rs.has_data = false;
+  m_rs.prior_delivered = 0;
+  m_rs.delivered = 0;
+  m_rs.delivery_rate = -1;
+  m_rs.is_app_limited = false;
+}
+
+// Record segment [seq, seq + size) sent at now.  If retransmission,
+// re-stamps record for segment.
+void RateSampler::onSend(SequenceNumber32 seq, uint32_t size, Time now) {
+
+  // Nothing in flight, so start intervals at now.
+  if (m_pkt_window.empty())
+    m_first_sent_time = m_delivered_time = now;
+
+  packet_struct p;
+  p.seq = seq;
+  p.end = seq + size;
+  p.send_time = now;
+  p.first_sent_time = m_first_sent_time;
+  p.delivered_time = m_delivered_time;
+  p.delivered = m_delivered;
+  p.is_app_limited = (m_app_limited != 0);
+  p.sacked = false;
+
+  // New data, so add (keeping records in sequence order).
+  if (m_pkt_window.empty() || seq >= m_pkt_window.back().end) {
+    m_pkt_window.push_back(p);
+    return;
+  }
+
+  // Retransmission, so re-stamp record holding seq.
+  size_t i = find(seq);
+  if (i == m_pkt_window.size())
+    return;  // Already ACKed.
+  p.seq = m_pkt_window[i].seq;
+  p.end = m_pkt_window[i].end;
+  p.sacked = m_pkt_window[i].sacked;
+  m_pkt_window[i] = p;
+}
+
+// On ACK, add bytes delivered (cumulatively ACKed or otherwise) at
+// now, retiring records cumulatively ACKed by ack.
+void RateSampler::onAck(SequenceNumber32 ack, uint32_t bytes, Time now) {
+  if (bytes > 0) {
+    m_delivered += bytes;
+    m_delivered_time = now;
+  }
+
+  // Records are in sequence order (oldest first), so each is visited
+  // once before removal.  SACKed records were sampled when SACKed.
+  while (!m_pkt_window.empty() && m_pkt_window.front().end <= ack) {
+    if (!m_pkt_window.front().sacked)
+      updateSample(m_pkt_window.front());
+    m_pkt_window.pop_front();
+  }
+}
+
+// On SACK of [start, end), deliver segments in block not already
+// SACKed at now (before onAck() for same ACK).
+// Return bytes newly SACKed.
+uint32_t RateSampler::onSack(SequenceNumber32 start, SequenceNumber32 end,
+                             Time now) {
+  uint32_t bytes = 0;
+
+  // Only segments entirely in block are delivered.
+  for (size_t i = lower(start);
+       i < m_pkt_window.size() && m_pkt_window[i].end <= end; i++) {
+    packet_struct &p = m_pkt_window[i];
+    if (p.sacked)
+      continue;
+    p.sacked = true;
+    bytes += p.end - p.seq;
+    m_delivered += p.end - p.seq;
+    m_delivered_time = now;
+    updateSample(p);
+  }
+
+  return bytes;
+}
+
+// Generate rate sample from ACK (after onAck()).  Samples with
+// interval less than min RTT are not valid (rate of -1).
+// Return true if valid.
+bool RateSampler::generate(Time min_rtt, rate_sample &rs) {
+
+  // App-limited phase ends once its data is delivered.
+  if (m_app_limited != 0 && m_delivered > m_app_limited)
+    m_app_limited = 0;
+
+  // Sample is for this ACK only.
+  rs = m_rs;
+  m_rs.has_data = false;
+  rs.delivery_rate = -1;
+  if (!rs.has_data)
+    return false;
+
+  // Use longer of send and ACK intervals, so ACK compression
+  // does not inflate rate.
+  rs.interval = std::max(rs.send_elapsed, rs.ack_elapsed);
+  rs.delivered = m_delivered - rs.prior_delivered;
+
+  // Interval less than min RTT is most likely from ACK compression
+  // (or spurious retransmission), so not valid.
+  if (!rs.interval.IsStrictlyPositive() ||
+      (min_rtt.IsStrictlyPositive() && rs.interval < min_rtt))
+    return false;
+
+  rs.delivery_rate = rs.delivered * 8 / rs.interval.GetSeconds(); // b/s.
+  rs.delivery_rate /= 1000000;                                     // Mb/s.
+  return true;
+}
+
+// Mark flow application limited until bytes in flight are delivered.
+void RateSampler::setAppLimited(uint32_t bytes_in_flight) {
+  m_app_limited = std::max(m_delivered + bytes_in_flight, (uint64_t) 1);
+}
+
+// Update rate sample with record delivered.  Sample uses newest
+// record delivered by ACK (most recently sent).
+void RateSampler::updateSample(packet_struct &p) {
+  if (m_rs.has_data && p.delivered < m_rs.prior_delivered)
+    return;
+
+  m_rs.has_data = true;
+  m_rs.prior_delivered = p.delivered;
+  m_rs.prior_time = p.delivered_time;
+  m_rs.is_app_limited = p.is_app_limited;
+  m_rs.send_elapsed = p.send_time - p.first_sent_time;
+  m_rs.ack_elapsed = m_delivered_time - p.delivered_time;
+  m_first_sent_time = p.send_time;
+}
+
+// Return index of record holding seq (size() if none).
+size_t RateSampler::find(SequenceNumber32 seq) const {
+  size_t i = lower(seq);
+  if (i < m_pkt_window.size() && m_pkt_window[i].seq == seq)
+    return i;
+
+  // Record at i starts after seq, so seq in one before (if any).
+  if (i == 0 || seq >= m_pkt_window[i - 1].end)
+    return m_pkt_window.size();
+  return i - 1;
+}
+
+// Return index of first record starting at or after seq.
+// Binary search, since records are in sequence order.
+size_t RateSampler::lower(SequenceNumber32 seq) const {
+  size_t lo = 0, hi = m_pkt_window.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (m_pkt_window[mid].seq < seq)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
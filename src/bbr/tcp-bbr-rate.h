@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef TCP_BBR_RATE_H
+#define TCP_BBR_RATE_H
+
+#include "ns3/nstime.h"
+#include "ns3/sequence-number.h"
+#include "tcp-bbr-ring.h"
+
+namespace ns3 {
+
+namespace bbr {
+
+// Per-packet send record (one per segment sent).
+struct packet_struct {
+  SequenceNumber32 seq;    // First sequence number sent.
+  SequenceNumber32 end;    // Next sequence number after segment.
+  Time send_time;          // Time (last) sent.
+  Time first_sent_time;    // Send time of first packet in flight.
+  Time delivered_time;     // Delivered time when sent.
+  uint64_t delivered;      // Delivered bytes when sent.
+  bool is_app_limited;     // True if sent when application limited.
+  bool sacked;             // True if delivered by SACK.
+};
+
+// Delivery rate sample (one per ACK).
+struct rate_sample {
+  bool has_data;           // True if ACK delivered a send record.
+  uint64_t prior_delivered;// Delivered bytes when record sent.
+  Time prior_time;         // Delivered time when record sent.
+  Time send_elapsed;       // Send time of record - first sent time.
+  Time ack_elapsed;        // Delivered time - prior time.
+  Time interval;           // Max of send elapsed and ACK elapsed.
+  uint64_t delivered;      // Bytes delivered over interval.
+  double delivery_rate;    // Mb/s (-1 if not valid).
+  bool is_app_limited;     // True if record sent when app limited.
+};
+
+///////////////////////////////////////////////////////////////////
+// Delivery rate sampler.
+//
+// As per [CCYJ17b] (Cheng et al., "Delivery Rate Estimation", IETF
+// Draft draft-cheng-iccrg-delivery-rate-estimation).  Each segment
+// sent is stamped with the connection's delivered bytes, delivered
+// time and first sent time.  When the segment is ACKed, the rate is
+// the bytes delivered since it was sent over the longer of the send
+// interval and the ACK interval, so ACK compression does not inflate
+// the rate.  Retransmitted segments are re-stamped and SACKed segments
+// are delivered when SACKed, so samples are taken during loss
+// recovery, too.
+//
+// Send records are kept in sequence order in a ring buffer.
+class RateSampler {
+
+ public:
+  // Constructor.
+  RateSampler();
+
+  // Return total bytes delivered.
+  uint64_t getDelivered() const { return m_delivered; }
+
+  // Return true if no send records (nothing in flight).
+  bool empty() const { return m_pkt_window.empty(); }
+
+  // Record segment [seq, seq + size) sent at now.  If retransmission,
+  // re-stamps record for segment.
+  void onSend(SequenceNumber32 seq, uint32_t size, Time now);
+
+  // On ACK, add bytes delivered (cumulatively ACKed or otherwise) at
+  // now, retiring records cumulatively ACKed by ack.
+  void onAck(SequenceNumber32 ack, uint32_t bytes, Time now);
+
+  // On SACK of [start, end), deliver segments in block not already
+  // SACKed at now (before onAck() for same ACK).
+  // Return bytes newly SACKed.
+  uint32_t onSack(SequenceNumber32 start, SequenceNumber32 end, Time now);
+
+  // Generate rate sample from ACK (after onAck()).  Samples with
+  // interval less than min RTT are not valid (rate of -1).
+  // Return true if valid.
+  bool generate(Time min_rtt, rate_sample &rs);
+
+  // Mark flow application limited until bytes in flight are delivered.
+  void setAppLimited(uint32_t bytes_in_flight);
+
+  // Return true if application limited.
+  bool isAppLimited() const { return m_app_limited != 0; }
+
+ private:
+  // Update rate sample with record delivered.
+  void updateSample(packet_struct &p);
+
+  // Return index of record holding seq (size() if none).
+  size_t find(SequenceNumber32 seq) const;
+
+  // Return index of first record starting at or after seq.
+  size_t lower(SequenceNumber32 seq) const;
+
+  RingBuffer<packet_struct> m_pkt_window; // Send records.
+  uint64_t m_delivered;                   // Bytes delivered.
+  Time m_delivered_time;                  // Time m_delivered last updated.
+  Time m_first_sent_time;                 // Send time of newest record delivered.
+  uint64_t m_app_limited;                 // App limited until delivered (0 if not).
+  rate_sample m_rs;                       // Sample for current ACK.
+};
+
+} // end of namespace bbr
+
+} // end of namespace ns3
+
+#endif // TCP_BBR_RATE_H
@@ -0,0 +1,282 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// System includes.
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// NS includes.
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "tcp-socket-base.h"
+
+// BBR' includes.
+#include "tcp-bbr.h"
+#include "tcp-bbr-recorder.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("BbrRecorder");
+NS_OBJECT_ENSURE_REGISTERED(BbrRecorder);
+
+///////////////////////////////////////////////
+// BBR' Recorder
+
+// Get type id.
+TypeId BbrRecorder::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::BbrRecorder")
+    .SetParent<Object>()
+    .SetGroupName("Internet")
+    .AddConstructor<BbrRecorder>();
+  return tid;
+}
+
+// Default constructor.
+BbrRecorder::BbrRecorder() {
+  NS_LOG_FUNCTION(this);
+  m_buf.reserve(bbr::RECORD_BUFFER);
+}
+
+// Destructor.
+BbrRecorder::~BbrRecorder() {
+  NS_LOG_FUNCTION(this);
+  Close();
+}
+
+// Close file and let go of flows (disconnected, so traces and
+// pending writes don't reach recorder once gone).
+void BbrRecorder::DoDispose(void) {
+  NS_LOG_FUNCTION(this);
+  Close();
+  for (size_t i = 0; i < m_flows.size(); i++)
+    m_flows[i] -> disconnect();
+  m_flows.clear();
+  Object::DoDispose();
+}
+
+// Open record file, writing header.  Return true if opened.
+bool BbrRecorder::Open(const std::string &filename) {
+  NS_LOG_FUNCTION(this << filename);
+
+  Close();
+  m_file.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!m_file.is_open()) {
+    NS_LOG_WARN(this << " Can't open: " << filename);
+    return false;
+  }
+
+  bbr::record_header header;
+  memcpy(header.magic, bbr::RECORD_MAGIC, sizeof(header.magic));
+  header.version = bbr::RECORD_VERSION;
+  header.record_size = sizeof(bbr::record);
+  m_file.write((const char *) &header, sizeof(header));
+  return true;
+}
+
+// Record flow on socket.  Return flow id.
+uint32_t BbrRecorder::Add(Ptr<TcpSocketBase> socket) {
+  NS_LOG_FUNCTION(this << socket);
+
+  uint32_t flow = m_flows.size();
+  Ptr<BbrRecorderFlow> f = Create<BbrRecorderFlow>(this, socket, flow);
+  m_flows.push_back(f);
+
+  f -> connect();
+
+  NS_LOG_INFO(this << " Flow: " << flow << "  BBR': " << f -> isBbr());
+  return flow;
+}
+
+// Add record (buffered).
+void BbrRecorder::Write(const bbr::record &r) {
+  if (!m_file.is_open())
+    return;
+  m_buf.push_back(r);
+  if (m_buf.size() >= bbr::RECORD_BUFFER)
+    Flush();
+}
+
+// Write buffered records to file.
+void BbrRecorder::Flush(void) {
+  NS_LOG_FUNCTION(this);
+  if (m_file.is_open() && !m_buf.empty())
+    m_file.write((const char *) &m_buf[0], m_buf.size() * sizeof(bbr::record));
+  m_buf.clear();
+}
+
+// Flush and close record file.
+void BbrRecorder::Close(void) {
+  if (!m_file.is_open())
+    return;
+  Flush();
+  m_file.close();
+}
+
+///////////////////////////////////////////////
+// BBR' Recorder flow
+
+// Constructor.
+BbrRecorderFlow::BbrRecorderFlow(BbrRecorder *recorder,
+                                 Ptr<TcpSocketBase> socket,
+                                 uint32_t flow) :
+  m_recorder(recorder),
+  m_socket(socket),
+  m_bbr(DynamicCast<TcpBbr>(socket -> GetCongestionControlAlgorithm())) {
+  memset(&m_record, 0, sizeof(m_record));
+  m_record.flow = flow;
+  m_record.bw = -1;
+  m_record.state = bbr::UNDEFINED_STATE;
+}
+
+// Connect trace sinks (BW and state only if BBR'), seeding current
+// values, since traces only fire on change (e.g., STARTUP is entered
+// before flow is added).
+void BbrRecorderFlow::connect(void) {
+  m_record.cwnd = m_socket -> GetCwnd();
+  if (m_bbr) {
+    m_record.bw = m_bbr -> getMaxBw();
+    m_record.state = m_bbr -> getState();
+  }
+
+  Ptr<BbrRecorderFlow> f(this);
+  m_socket -> TraceConnectWithoutContext("Rx", MakeCallback(&BbrRecorderFlow::rx, f));
+  m_socket -> TraceConnectWithoutContext("CongestionWindow", MakeCallback(&BbrRecorderFlow::cwnd, f));
+  m_socket -> TraceConnectWithoutContext("RTT", MakeCallback(&BbrRecorderFlow::rtt, f));
+  if (m_bbr) {
+    m_bbr -> TraceConnectWithoutContext("MaxBw", MakeCallback(&BbrRecorderFlow::bw, f));
+    m_bbr -> TraceConnectWithoutContext("State", MakeCallback(&BbrRecorderFlow::state, f));
+  }
+}
+
+// Disconnect trace sinks, cancel pending write and forget recorder
+// (breaks socket -> callback -> flow cycle, too).
+void BbrRecorderFlow::disconnect(void) {
+  Ptr<BbrRecorderFlow> f(this);
+  m_socket -> TraceDisconnectWithoutContext("Rx", MakeCallback(&BbrRecorderFlow::rx, f));
+  m_socket -> TraceDisconnectWithoutContext("CongestionWindow", MakeCallback(&BbrRecorderFlow::cwnd, f));
+  m_socket -> TraceDisconnectWithoutContext("RTT", MakeCallback(&BbrRecorderFlow::rtt, f));
+  if (m_bbr) {
+    m_bbr -> TraceDisconnectWithoutContext("MaxBw", MakeCallback(&BbrRecorderFlow::bw, f));
+    m_bbr -> TraceDisconnectWithoutContext("State", MakeCallback(&BbrRecorderFlow::state, f));
+  }
+  m_write_event.Cancel();
+  m_recorder = NULL;
+}
+
+// ACK received, so write record once processed.
+void BbrRecorderFlow::rx(Ptr<const Packet> p, const TcpHeader &h,
+                         Ptr<const TcpSocketBase> socket) {
+  if ((h.GetFlags() & TcpHeader::ACK) && !m_write_event.IsRunning())
+    m_write_event = Simulator::ScheduleNow(&BbrRecorderFlow::write,
+                                           Ptr<BbrRecorderFlow>(this));
+}
+
+// Latest cwnd.
+void BbrRecorderFlow::cwnd(uint32_t old_cwnd, uint32_t new_cwnd) {
+  m_record.cwnd = new_cwnd;
+}
+
+// Latest RTT sample.
+void BbrRecorderFlow::rtt(Time old_rtt, Time new_rtt) {
+  m_record.rtt = new_rtt.GetNanoSeconds();
+}
+
+// Latest max BW (BBR').
+void BbrRecorderFlow::bw(double old_bw, double new_bw) {
+  m_record.bw = new_bw;
+}
+
+// Latest state (BBR').
+void BbrRecorderFlow::state(bbr::bbr_state old_state, bbr::bbr_state new_state) {
+  m_record.state = new_state;
+}
+
+// Write record of flow.
+void BbrRecorderFlow::write(void) {
+  if (!m_recorder)
+    return;  // Recorder gone.
+  m_record.time = Simulator::Now().GetNanoSeconds();
+  m_record.pacing_rate = m_socket -> GetPacingRate();
+  m_record.inflight = m_socket -> BytesInFlight();
+  m_recorder -> Write(m_record);
+}
+
+///////////////////////////////////////////////
+// BBR' Record reader
+
+// Constructor.
+BbrRecordReader::BbrRecordReader() :
+  m_map(NULL),
+  m_map_size(0),
+  m_records(NULL),
+  m_size(0) {
+}
+
+// Destructor.
+BbrRecordReader::~BbrRecordReader() {
+  Close();
+}
+
+// Map record file.  Return false if can't or not a record file.
+bool BbrRecordReader::Open(const std::string &filename) {
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(bbr::record_header)) {
+    close(fd);
+    return false;
+  }
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // Mapping stays valid.
+  if (map == MAP_FAILED)
+    return false;
+
+  // Check header.
+  const bbr::record_header *header = (const bbr::record_header *) map;
+  if (memcmp(header -> magic, bbr::RECORD_MAGIC, sizeof(header -> magic)) != 0 ||
+      header -> version != bbr::RECORD_VERSION ||
+      header -> record_size != sizeof(bbr::record)) {
+    munmap(map, st.st_size);
+    return false;
+  }
+
+  m_map = map;
+  m_map_size = st.st_size;
+  m_records = (const bbr::record *) ((const char *) map + sizeof(bbr::record_header));
+  m_size = (m_map_size - sizeof(bbr::record_header)) / sizeof(bbr::record);
+  return true;
+}
+
+// Unmap record file.
+void BbrRecordReader::Close(void) {
+  if (m_map)
+    munmap(m_map, m_map_size);
+  m_map = NULL;
+  m_map_size = 0;
+  m_records = NULL;
+  m_size = 0;
+}
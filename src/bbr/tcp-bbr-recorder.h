@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef TCP_BBR_RECORDER_H
+#define TCP_BBR_RECORDER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/tcp-header.h"
+#include "tcp-bbr.h"
+
+namespace ns3 {
+
+class TcpSocketBase;
+
+namespace bbr {
+
+// Record file format: header, then fixed-width records (native byte
+// order), so file can be mapped into memory and indexed directly.
+const char RECORD_MAGIC[8] = {'B', 'B', 'R', 'R', 'E', 'C', '0', '1'};
+const uint32_t RECORD_VERSION = 1;
+const uint32_t RECORD_BUFFER = 4096;  // Records buffered before write.
+
+// Record file header.
+struct record_header {
+  char magic[8];           // RECORD_MAGIC.
+  uint32_t version;        // RECORD_VERSION.
+  uint32_t record_size;    // sizeof(record).
+};
+
+// One record per ACK received by a flow (after ACK is processed).
+struct record {
+  int64_t time;            // Nanoseconds.
+  int64_t rtt;             // Last RTT sample (nanoseconds).
+  double pacing_rate;      // Mb/s.
+  double bw;               // Max BW estimate (Mb/s, -1 if not BBR').
+  uint32_t flow;           // Flow id (order added to recorder).
+  uint32_t cwnd;           // Bytes.
+  uint32_t inflight;       // Bytes.
+  int32_t state;           // bbr::bbr_state (UNDEFINED_STATE if not BBR').
+};
+
+} // end of namespace bbr
+
+class BbrRecorderFlow;
+
+///////////////////////////////////////////////////////////////////
+// Per-flow time-series recorder for BBR' experiments.
+//
+// Flows (sockets) are added once connected (e.g., scheduled after
+// the application starts).  For each ACK a flow receives, a record
+// of the flow's state is written to the record file, buffered so
+// writes are in large blocks.  Attaches to trace sources of
+// TcpSocketBase and, if BBR', TcpBbr.  See BbrRecordReader for
+// reading.
+class BbrRecorder : public Object {
+
+ public:
+  static TypeId GetTypeId(void);
+
+  BbrRecorder();
+  virtual ~BbrRecorder();
+
+  // Open record file, writing header.  Return true if opened.
+  bool Open(const std::string &filename);
+
+  // Record flow on socket.  Return flow id.
+  uint32_t Add(Ptr<TcpSocketBase> socket);
+
+  // Write buffered records to file.
+  void Flush(void);
+
+  // Flush and close record file.
+  void Close(void);
+
+  // Add record (buffered).
+  void Write(const bbr::record &r);
+
+ protected:
+  virtual void DoDispose(void);
+
+ private:
+  std::ofstream m_file;                    // Record file.
+  std::vector<bbr::record> m_buf;          // Records not yet written.
+  std::vector<Ptr<BbrRecorderFlow> > m_flows; // Flows recorded.
+};
+
+// Flow recorded by BbrRecorder, keeping latest values from traces.
+class BbrRecorderFlow : public SimpleRefCount<BbrRecorderFlow> {
+
+ public:
+  BbrRecorderFlow(BbrRecorder *recorder, Ptr<TcpSocketBase> socket,
+                  uint32_t flow);
+
+  // Connect trace sinks to socket (and BBR').
+  void connect(void);
+
+  // Disconnect trace sinks, cancel pending write and forget recorder.
+  void disconnect(void);
+
+  // Return true if socket's congestion control is BBR'.
+  bool isBbr(void) const { return m_bbr != 0; }
+
+  // Trace sinks.
+  void rx(Ptr<const Packet> p, const TcpHeader &h,
+          Ptr<const TcpSocketBase> socket);
+  void cwnd(uint32_t old_cwnd, uint32_t new_cwnd);
+  void rtt(Time old_rtt, Time new_rtt);
+  void bw(double old_bw, double new_bw);
+  void state(bbr::bbr_state old_state, bbr::bbr_state new_state);
+
+  // Write record of flow.
+  void write(void);
+
+ private:
+  BbrRecorder *m_recorder;                 // Recorder (NULL if gone).
+  Ptr<TcpSocketBase> m_socket;             // Socket recorded.
+  Ptr<TcpBbr> m_bbr;                       // Socket's BBR' (0 if not).
+  EventId m_write_event;                   // Pending write (after ACK).
+  bbr::record m_record;                    // Latest values.
+};
+
+///////////////////////////////////////////////////////////////////
+// Reader for BbrRecorder files.
+//
+// Maps record file into memory (read-only), so records are read in
+// place, without parsing.
+class BbrRecordReader {
+
+ public:
+  BbrRecordReader();
+  ~BbrRecordReader();
+
+  // Map record file.  Return false if can't or not a record file.
+  bool Open(const std::string &filename);
+
+  // Unmap record file.
+  void Close(void);
+
+  // Return number of records.
+  size_t size() const { return m_size; }
+
+  // Return i-th record.
+  const bbr::record &operator[](size_t i) const { return m_records[i]; }
+
+  // Return first record and one past last record (for iterating).
+  const bbr::record *begin() const { return m_records; }
+  const bbr::record *end() const { return m_records + m_size; }
+
+ private:
+  // No copying (owns mapping).
+  BbrRecordReader(const BbrRecordReader &);
+  BbrRecordReader &operator=(const BbrRecordReader &);
+
+  void *m_map;                             // Mapping (NULL if none).
+  size_t m_map_size;                       // Bytes mapped.
+  const bbr::record *m_records;            // First record.
+  size_t m_size;                           // Number of records.
+};
+
+} // end of namespace ns3
+
+#endif // TCP_BBR_RECORDER_H
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef TCP_BBR_RING_H
+#define TCP_BBR_RING_H
+
+#include <vector>
+#include "ns3/assert.h"
+
+namespace ns3 {
+
+namespace bbr {
+
+///////////////////////////////////////////////////////////////////
+// Ring buffer (FIFO) with power-of-two capacity.
+//
+// Used for per-packet send records, which are added in sequence
+// order as segments are sent and retired in sequence order as they
+// are ACKed.  Adding and retiring are O(1) amortized, and entries
+// can be indexed from the oldest (0) to the newest (size() - 1).
+// Capacity doubles when full, so is bounded by the largest window.
+template <class T>
+class RingBuffer {
+
+ public:
+  // Constructor (capacity must be a power of two).
+  RingBuffer(size_t capacity = 64) :
+    m_buf(capacity),
+    m_mask(capacity - 1),
+    m_head(0),
+    m_size(0) {
+    NS_ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  }
+
+  // Return number of entries.
+  size_t size() const { return m_size; }
+
+  // Return true if no entries.
+  bool empty() const { return m_size == 0; }
+
+  // Remove all entries.
+  void clear() { m_head = 0; m_size = 0; }
+
+  // Return i-th entry, from oldest (0) to newest (size() - 1).
+  T &operator[](size_t i) { return m_buf[(m_head + i) & m_mask]; }
+  const T &operator[](size_t i) const { return m_buf[(m_head + i) & m_mask]; }
+
+  // Return oldest entry.
+  T &front() { return (*this)[0]; }
+  const T &front() const { return (*this)[0]; }
+
+  // Return newest entry.
+  T &back() { return (*this)[m_size - 1]; }
+  const T &back() const { return (*this)[m_size - 1]; }
+
+  // Add entry as newest, growing if full.
+  void push_back(const T &entry) {
+    if (m_size == m_buf.size())
+      grow();
+    m_buf[(m_head + m_size) & m_mask] = entry;
+    m_size++;
+  }
+
+  // Remove oldest entry.
+  void pop_front() {
+    NS_ASSERT(m_size > 0);
+    m_head = (m_head + 1) & m_mask;
+    m_size--;
+  }
+
+ private:
+  // Double capacity, moving entries so oldest is first.
+  void grow() {
+    std::vector<T> buf(m_buf.size() * 2);
+    for (size_t i = 0; i < m_size; i++)
+      buf[i] = (*this)[i];
+    m_buf.swap(buf);
+    m_mask = m_buf.size() - 1;
+    m_head = 0;
+  }
+
+  std::vector<T> m_buf;      // Entries.
+  size_t m_mask;             // Capacity - 1 (for wrapping index).
+  size_t m_head;             // Index of oldest entry.
+  size_t m_size;             // Number of entries.
+};
+
+} // end of namespace bbr
+
+} // end of namespace ns3
+
+#endif // TCP_BBR_RING_H
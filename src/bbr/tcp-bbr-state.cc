@@ -6,6 +6,7 @@
 
 // Include files.
 #include "ns3/log.h"
+#include "ns3/simulator.h"
 #include "tcp-bbr.h"
 #include "tcp-bbr-state.h"
 
@@ -24,29 +25,33 @@ NS_OBJECT_ENSURE_REGISTERED(BbrState);
 //  State transition diagram:
 //          |
 //          V
-//       STARTUP  
-//          |     
-//          V     
-//        DRAIN   
-//          |     
-//          V     
-// +---> PROBE_BW ----+
-// |      ^    |      |
-// |      |    |      |
-// |      +----+      |
-// |                  |
-// +---- PROBE_RTT <--+
+//       STARTUP  ---------+
+//          |     ^        |
+//          V     |        |
+//        DRAIN   |  ------+
+//          |     |        |
+//          V     |        |
+// +---> PROBE_BW ----+    |
+// |      ^    |      |    |
+// |      |    |      |    |
+// |      +----+      |    |
+// |              |   |    |
+// +---- PROBE_RTT <--+----+
+//
+// Any state enters PROBE_RTT when min RTT has not changed in limit.
+// PROBE_RTT exits to PROBE_BW if STARTUP found full BW (filled pipe),
+// else back to STARTUP.
 
 // Default constructor.
 BbrStateMachine::BbrStateMachine() {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
   m_owner = NULL;
   m_state = NULL;
 }
 
 // Default constructor.
 BbrStateMachine::BbrStateMachine(TcpBbr *owner) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
   m_owner = owner;
   m_state = NULL;
 }
@@ -62,25 +67,27 @@ TypeId BbrStateMachine::GetTypeId(void) {
 
 // Get name of object.
 std::string BbrStateMachine::GetName() const {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
   return "BbrStateMachine";
 }
 
-// Get type of current state.
+// Get type of current state (UNDEFINED_STATE if none).
 bbr::bbr_state BbrStateMachine::getStateType() const {
-  return m_state -> getType();
+  return m_state ? m_state -> getType() : bbr::UNDEFINED_STATE;
 }
 
 // Update by executing current state.
+// Called once per packet-timed round (from TcpBbr::PktsAcked()) and
+// at the PROBE_RTT deadline, so no timer is kept per flow otherwise.
 void BbrStateMachine::update() {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 
   if (m_state == NULL) {
-    NS_LOG_INFO(this << " m_state NULL. Probably flow terminated, so ok.");
+    BBR_LOG_INFO(this << " m_state NULL. Probably flow terminated, so ok.");
     return;
   }
 
-  NS_LOG_LOGIC(this << "  State: " << m_state -> GetName());
+  BBR_LOG_LOGIC(this << "  State: " << m_state -> GetName());
 
   // Check if should enter PROBE_RTT.
   if (m_owner -> checkProbeRTT())
@@ -94,26 +101,22 @@ void BbrStateMachine::update() {
 
   // Cull BW window (except in DRAIN state).
   m_owner -> cullBWwindow();
-
-  // Schedule next event (if we can).
-  Time rtt = m_owner -> getRTT();
-  if (!rtt.IsNegative()) {
-    Simulator::Schedule(rtt, &BbrStateMachine::update, this);
-    NS_LOG_LOGIC(this << "  Next event: " << rtt.GetSeconds());
-  } else // update() will be called in PktsAcked() upon getting first rtt.
-    NS_LOG_LOGIC(this << "  Not scheduling next event.");
 }
 
 // Change current state to new state.
 void BbrStateMachine::changeState(BbrState *new_state) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
   NS_ASSERT(new_state != NULL);
   if (m_state)
-    NS_LOG_LOGIC(this <<
+    BBR_LOG_LOGIC(this <<
 		"  Old: " << m_state -> GetName() <<
 		"  New: " << new_state -> GetName());
   else
-    NS_LOG_LOGIC(this << " Initial state: " << new_state -> GetName());
+    BBR_LOG_LOGIC(this << " Initial state: " << new_state -> GetName());
+
+  // Trace change.
+  m_owner -> m_state_trace(m_state ? m_state -> getType() : bbr::UNDEFINED_STATE,
+                           new_state -> getType());
 
   // Call exit on old state.
   if (m_state)
@@ -167,13 +170,13 @@ void BbrState::exit() {
 BbrStartupState::BbrStartupState(TcpBbr *owner) : BbrState(owner),
   m_full_bw(0),
   m_full_bw_count(0) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 }
 
 BbrStartupState::BbrStartupState() : BbrState(),
   m_full_bw(0),
   m_full_bw_count(0) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 }
 
 // Get type id.
@@ -197,30 +200,30 @@ bbr::bbr_state BbrStartupState::getType(void) const {
 
 // Invoked when state first entered.
 void BbrStartupState::enter() {
-  NS_LOG_FUNCTION(this);
-  NS_LOG_INFO(this << " State: " << GetName());
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_INFO(this << " State: " << GetName());
 
   // Set gains to 2/ln(2).
-  m_owner -> m_pacing_gain = bbr::STARTUP_GAIN;
-  m_owner -> m_cwnd_gain = bbr::STARTUP_GAIN;
+  m_owner -> m_pacing_gain = m_owner -> m_startup_gain;
+  m_owner -> m_cwnd_gain = m_owner -> m_startup_gain;
 }
 
 // Invoked when state updated.
 void BbrStartupState::execute() {
-  NS_LOG_FUNCTION(this);
-  NS_LOG_LOGIC(this << " State: " << GetName());
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_LOGIC(this << " State: " << GetName());
 
   double new_bw = m_owner -> getBW();
 
   // If no legitimate estimates yet, no more to do.
   if (new_bw < 0) {
-    NS_LOG_LOGIC(this << "  No BW estimates yet.");
+    BBR_LOG_LOGIC(this << "  No BW estimates yet.");
     return;
   }
   
   // Still growing?
-  if (new_bw > m_full_bw * bbr::STARTUP_THRESHOLD) { 
-    NS_LOG_LOGIC(this << "  Still growing. old_bw: " << m_full_bw << "  new_bw: " << new_bw);
+  if (new_bw > m_full_bw * m_owner -> m_startup_threshold) { 
+    BBR_LOG_LOGIC(this << "  Still growing. old_bw: " << m_full_bw << "  new_bw: " << new_bw);
     m_full_bw = new_bw;
     m_full_bw_count = 0;
     return;
@@ -228,11 +231,12 @@ void BbrStartupState::execute() {
 
   // Another round w/o much growth.
   m_full_bw_count++;
-  NS_LOG_LOGIC(this << "  Growth stalled. old_bw: " << m_full_bw << "  new_bw: " << new_bw << "  full-bw-count: " << m_full_bw_count);
+  BBR_LOG_LOGIC(this << "  Growth stalled. old_bw: " << m_full_bw << "  new_bw: " << new_bw << "  full-bw-count: " << m_full_bw_count);
   
   // If 3+ rounds w/out much growth, STARTUP --> DRAIN.
   if (m_full_bw_count > 2) {
-    NS_LOG_LOGIC(this << "  Exiting STARTUP, next state DRAIN");
+    BBR_LOG_LOGIC(this << "  Exiting STARTUP, next state DRAIN");
+    m_owner -> m_filled_pipe = true;
     m_owner -> m_machine.changeState(&m_owner -> m_state_drain);
   }
 
@@ -246,14 +250,14 @@ BbrDrainState::BbrDrainState(TcpBbr *owner) :
   BbrState(owner),
   m_inflight_limit(0),
   m_round_count(0) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 }
 
 BbrDrainState::BbrDrainState() :
   BbrState(),
   m_inflight_limit(0),
   m_round_count(0) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 }
 
 // Get type id.
@@ -277,17 +281,17 @@ bbr::bbr_state BbrDrainState::getType(void) const {
 
 // Invoked when state first entered.
 void BbrDrainState::enter() {
-  NS_LOG_FUNCTION(this);
-  NS_LOG_INFO(this << " State: " << GetName());
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_INFO(this << " State: " << GetName());
 
   // Set pacing gain to 1/[2/ln(2)].
-  m_owner -> m_pacing_gain = 1 / bbr::STARTUP_GAIN;
+  m_owner -> m_pacing_gain = 1 / m_owner -> m_startup_gain;
 
   // Maintain high cwnd gain.
-  if (PACING_CONFIG == NO_PACING)
-    m_owner -> m_cwnd_gain = 1 / bbr::STARTUP_GAIN; // Slow cwnd if no pacing.
+  if (m_owner -> m_pacing_config == NO_PACING)
+    m_owner -> m_cwnd_gain = 1 / m_owner -> m_startup_gain; // Slow cwnd if no pacing.
   else
-    m_owner -> m_cwnd_gain = bbr::STARTUP_GAIN; // Maintain high cwnd gain.
+    m_owner -> m_cwnd_gain = m_owner -> m_startup_gain; // Maintain high cwnd gain.
 
   // Get BDP for target inflight limit when will exit STARTUUP..
   double bdp = m_owner -> getBDP();
@@ -298,10 +302,10 @@ void BbrDrainState::enter() {
 
 // Invoked when state updated.
 void BbrDrainState::execute() {
-  NS_LOG_FUNCTION(this);
-  NS_LOG_LOGIC(this << " State: " << GetName());
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_LOGIC(this << " State: " << GetName());
 
-  NS_LOG_LOGIC(this << " " <<
+  BBR_LOG_LOGIC(this << " " <<
 	      GetName() <<
 	      "  round: " << m_round_count <<
 	      "  bytes_in_flight: " << m_owner -> m_bytes_in_flight <<
@@ -313,7 +317,7 @@ void BbrDrainState::execute() {
   m_round_count++;
   if (m_owner -> m_bytes_in_flight < m_inflight_limit ||
       m_round_count == 5) {
-    NS_LOG_LOGIC(this << " Exiting DRAIN, next state PROBE_BW");
+    BBR_LOG_LOGIC(this << " Exiting DRAIN, next state PROBE_BW");
     m_owner -> m_machine.changeState(&m_owner -> m_state_probe_bw);
   }
 }
@@ -322,11 +326,11 @@ void BbrDrainState::execute() {
 // BBR' PROBE_BW
   
 BbrProbeBWState::BbrProbeBWState(TcpBbr *owner) : BbrState(owner) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 }
 
 BbrProbeBWState::BbrProbeBWState() : BbrState() {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 }
 
 // Get type id.
@@ -350,56 +354,57 @@ bbr::bbr_state BbrProbeBWState::getType(void) const {
 
 // Invoked when state first entered.
 void BbrProbeBWState::enter() {
-  NS_LOG_FUNCTION(this);
-  NS_LOG_INFO(this << " State: " << GetName());
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_INFO(this << " State: " << GetName());
 
   // Pick random start cycle phase (except "low") to avoid synch of
-  // flows that enter PROBE_BW simultaneously.
+  // flows that enter PROBE_BW simultaneously.  Uses ns-3 RNG (see
+  // TcpBbr::AssignStreams()), so reproducible for same run/stream.
   do {
-    m_gain_cycle = rand() % 8;
+    m_gain_cycle = m_owner -> m_rng -> GetInteger(0, 7);
   } while (m_gain_cycle == 1);  // Phase 1 is "low" cycle.
 
-  NS_LOG_LOGIC(this << " " << GetName() << " Start cycle: " << m_gain_cycle);
+  BBR_LOG_LOGIC(this << " " << GetName() << " Start cycle: " << m_gain_cycle);
 
   // Set gains based on phase.
-  m_owner -> m_pacing_gain = bbr::STEADY_FACTOR;
+  m_owner -> m_pacing_gain = m_owner -> m_steady_factor;
   if (m_gain_cycle == 0) // Phase 0 is "high" cycle.
-    m_owner -> m_pacing_gain += bbr::PROBE_FACTOR;
-  if (PACING_CONFIG == NO_PACING)
+    m_owner -> m_pacing_gain += m_owner -> m_probe_factor;
+  if (m_owner -> m_pacing_config == NO_PACING)
     m_owner -> m_cwnd_gain = m_owner -> m_pacing_gain;
   else
-    m_owner -> m_cwnd_gain = bbr::STEADY_FACTOR * 2;
+    m_owner -> m_cwnd_gain = m_owner -> m_steady_factor * 2;
 }
 
 // Invoked when state updated.
 void BbrProbeBWState::execute() {
-  NS_LOG_FUNCTION(this);
-  NS_LOG_LOGIC(this << " " << GetName() << "  m_gain_cycle: " << m_gain_cycle);
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_LOGIC(this << " " << GetName() << "  m_gain_cycle: " << m_gain_cycle);
 
   // Set gain rate: [high, low, stdy, stdy, stdy, stdy, stdy, stdy]
   if (m_gain_cycle == 0)
-    m_owner -> m_pacing_gain = bbr::STEADY_FACTOR + bbr::PROBE_FACTOR;
+    m_owner -> m_pacing_gain = m_owner -> m_steady_factor + m_owner -> m_probe_factor;
   else if (m_gain_cycle == 1)
-    if (PACING_CONFIG == NO_PACING) 
-      m_owner -> m_pacing_gain = bbr::STEADY_FACTOR - bbr::DRAIN_FACTOR/8;
+    if (m_owner -> m_pacing_config == NO_PACING) 
+      m_owner -> m_pacing_gain = m_owner -> m_steady_factor - m_owner -> m_drain_factor/8;
     else
-      m_owner -> m_pacing_gain = bbr::STEADY_FACTOR - bbr::DRAIN_FACTOR;
+      m_owner -> m_pacing_gain = m_owner -> m_steady_factor - m_owner -> m_drain_factor;
   else
-    m_owner -> m_pacing_gain = bbr::STEADY_FACTOR;
+    m_owner -> m_pacing_gain = m_owner -> m_steady_factor;
 
-  if (PACING_CONFIG == NO_PACING)
+  if (m_owner -> m_pacing_config == NO_PACING)
     // If configed for NO_PACING, rate is controlled by cwnd at bdp.
     m_owner -> m_cwnd_gain = m_owner -> m_pacing_gain;
   else
     // Otherwise, cwnd can be twice bdp.
-    m_owner -> m_cwnd_gain = 2 * bbr::STEADY_FACTOR;
+    m_owner -> m_cwnd_gain = 2 * m_owner -> m_steady_factor;
 
   // Move to next cycle, wrapping.
   m_gain_cycle++;
   if (m_gain_cycle > 7)
     m_gain_cycle = 0;
 
-  NS_LOG_LOGIC(this << " " <<
+  BBR_LOG_LOGIC(this << " " <<
 	      GetName() << " DATA pacing-gain: " << m_owner -> m_pacing_gain);
 }
 
@@ -407,11 +412,16 @@ void BbrProbeBWState::execute() {
 // BBR' PROBE_RTT
   
 BbrProbeRTTState::BbrProbeRTTState(TcpBbr *owner) : BbrState(owner) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 }
 
 BbrProbeRTTState::BbrProbeRTTState() : BbrState() {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
+}
+
+BbrProbeRTTState::~BbrProbeRTTState() {
+  BBR_LOG_FUNCTION(this);
+  m_probe_rtt_event.Cancel();
 }
 
 // Get type id.
@@ -435,37 +445,57 @@ bbr::bbr_state BbrProbeRTTState::getType(void) const {
 
 // Invoked when state first entered.
 void BbrProbeRTTState::enter() {
-  NS_LOG_FUNCTION(this);
-  NS_LOG_LOGIC(this << " State: " << GetName());
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_LOGIC(this << " State: " << GetName());
 
   // Set gains (Send() will minimize window);
-  m_owner -> m_pacing_gain = bbr::STEADY_FACTOR;
-  m_owner -> m_cwnd_gain = bbr::STEADY_FACTOR;
+  m_owner -> m_pacing_gain = m_owner -> m_steady_factor;
+  m_owner -> m_cwnd_gain = m_owner -> m_steady_factor;
 
-  // Compute time when to exit: max (0.2 seconds, min RTT).
+  // Compute time when to exit: max (min time (0.2 seconds), min RTT).
   Time rtt = m_owner -> getRTT();
-  if (rtt.GetSeconds() > 0.2)
+  if (rtt > m_owner -> m_probe_rtt_min_time)
     m_probe_rtt_time = rtt;
   else
-    m_probe_rtt_time = Time(0.2 * 1000000000);
+    m_probe_rtt_time = m_owner -> m_probe_rtt_min_time;
   m_probe_rtt_time = m_probe_rtt_time + Simulator::Now();
     
-  NS_LOG_LOGIC(this << " " <<
+  BBR_LOG_LOGIC(this << " " <<
 	      GetName() << " In PROBE_RTT until: " << m_probe_rtt_time.GetSeconds());
+
+  // Update at deadline, in case round ends later (or not at all).
+  m_probe_rtt_event.Cancel();
+  m_probe_rtt_event = Simulator::Schedule(m_probe_rtt_time - Simulator::Now(),
+                                          &BbrStateMachine::update,
+                                          &m_owner -> m_machine);
 }
 
 // Invoked when state updated.
 void BbrProbeRTTState::execute() {
-  NS_LOG_FUNCTION(this);
-  NS_LOG_LOGIC(this << " State: " << GetName());
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_LOGIC(this << " State: " << GetName());
 
   // Cwnd target is minimum.
-  m_owner -> m_cwnd = bbr::MIN_CWND * 1500; // In bytes.
+  m_owner -> m_cwnd = m_owner -> m_min_cwnd; // In bytes.
 
-  // If enough time elapsed, PROBE_RTT --> PROBE_BW.
+  // If enough time elapsed, PROBE_RTT --> PROBE_BW if pipe filled,
+  // else PROBE_RTT --> STARTUP.
   Time now = Simulator::Now();
-  if (now > m_probe_rtt_time) {
-      NS_LOG_LOGIC(this << " Exiting PROBE_RTT, next state PROBE_BW");
+  if (now >= m_probe_rtt_time) {
+    if (m_owner -> m_filled_pipe) {
+      BBR_LOG_LOGIC(this << " Exiting PROBE_RTT, next state PROBE_BW");
       m_owner -> m_machine.changeState(&m_owner -> m_state_probe_bw);
+    } else {
+      BBR_LOG_LOGIC(this << " Exiting PROBE_RTT, next state STARTUP");
+      m_owner -> m_machine.changeState(&m_owner -> m_state_startup);
+    }
   }
 }
+
+// Invoked when state exited.
+void BbrProbeRTTState::exit() {
+  BBR_LOG_FUNCTION(this);
+
+  // Deadline no longer needed.
+  m_probe_rtt_event.Cancel();
+}
@@ -9,6 +9,7 @@
 
 #include "ns3/object.h"
 #include "ns3/nstime.h"
+#include "ns3/event-id.h"
 
 namespace ns3 {
 
@@ -46,10 +47,10 @@ class BbrStateMachine : public Object {
   // Change state machine to new state.
   void changeState(BbrState *p_new_state);
 
-  // Get type of current state.
+  // Get type of current state (UNDEFINED_STATE if none).
   bbr::bbr_state getStateType() const;
 
-  // Update by executing current state.
+  // Update by executing current state (once per packet-timed round).
   void update();
 
  private:
@@ -196,6 +197,9 @@ class BbrProbeRTTState : public BbrState {
   BbrProbeRTTState(TcpBbr *owner);
   BbrProbeRTTState();
 
+  // Destructor.
+  ~BbrProbeRTTState();
+
   // Get state type.
   bbr::bbr_state getType() const;
 
@@ -205,8 +209,12 @@ class BbrProbeRTTState : public BbrState {
   // Invoked when state updated.
   void execute();
 
+  // Invoked when state exited.
+  void exit();
+
  private:
   Time m_probe_rtt_time;     // Time to remain in PROBE_RTT.
+  EventId m_probe_rtt_event; // Update at PROBE_RTT deadline.
 };
 
 } // end of namespace ns3
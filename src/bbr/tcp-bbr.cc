@@ -18,16 +18,24 @@
  */
 
 // System includes.
+#include <algorithm>
 #include <iostream>
 
 // NS includes.
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/integer.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
 #include "tcp-socket-base.h"          // For pacing configuration options.
 
 // BBR' includes.
 #include "rtt-estimator.h"
 #include "tcp-bbr.h"
+#include "tcp-bbr-profile.h"
 
 using namespace ns3;
 
@@ -41,52 +49,77 @@ TcpBbr::TcpBbr(void) :
   m_pacing_gain(0.0),
   m_cwnd_gain(0.0),
   m_round(0),
-  m_delivered(0),
   m_next_round_delivered(0),
+  m_delivered_ack(0),
+  m_delivered_credit(0),
+  m_sacked_bytes(0),
+  m_sack_seen(false),
   m_bytes_in_flight(0),
   m_min_rtt_change(Time(0)),
+  m_filled_pipe(false),
   m_cwnd(0.0),
   m_prior_cwnd(0.0), 
   m_packet_conservation(Time(0)),
-  m_in_retrans_seq(false),
-  m_retrans_seq(0),
   m_machine(this),
   m_state_startup(this),
   m_state_drain(this),
   m_state_probe_bw(this),
-  m_state_probe_rtt(this) {
-
-  NS_LOG_FUNCTION(this);
-  NS_LOG_INFO(this << "  BBR' version: v" << bbr::VERSION);
-
-  // Constants in "tcp-bbr.h"
-  NS_LOG_INFO(this << "  INIT_RTT: " << bbr::INIT_RTT.GetSeconds() << " sec");
-  NS_LOG_INFO(this << "  INIT_BW: " << bbr::INIT_BW << " Mb/s");
-  NS_LOG_INFO(this << "  BW_WINDOW_TIME: " << bbr::BW_WINDOW_TIME << " rtts");
-  NS_LOG_INFO(this << "  MIN_CWND: " << bbr::MIN_CWND << " bytes");
-  NS_LOG_INFO(this << "  STARTUP_THRESHOLD: " << bbr::STARTUP_THRESHOLD);
-  NS_LOG_INFO(this << "  STARTUP_GAIN: " << bbr::STARTUP_GAIN);
-  NS_LOG_INFO(this << "  STEADY_FACTOR: " << bbr::STEADY_FACTOR);
-  NS_LOG_INFO(this << "  PROBE_FACTOR: " << bbr::PROBE_FACTOR);
-  NS_LOG_INFO(this << "  DRAIN_FACTOR: " << bbr::DRAIN_FACTOR);
-  NS_LOG_INFO(this << "  PACING_FACTOR: " << bbr::PACING_FACTOR);
-
-  // Timing config (used for culling BW window) in "tcp-bbr.h"
-  if (bbr::TIME_CONFIG == bbr::WALLCLOCK_TIME) 
-    NS_LOG_INFO("TIME_CONFIG: WALLCLOCK_TIME - BW window culling with wallclock time.");
-  else if (bbr::TIME_CONFIG == bbr::PACKET_TIME) 
-    NS_LOG_INFO("TIME_CONFIG: PACKET_TIME - BW window culling with packet time.");
-  else  {
-    NS_LOG_INFO("WARNING! Unknown TIME_CONFIG: " << bbr::TIME_CONFIG);
-    NS_LOG_INFO("BW window culling with packet time.");
-  }
+  m_state_probe_rtt(this),
+  m_pacing_config(PACING_CONFIG),
+  m_rng(CreateObject<UniformRandomVariable>()),
+  m_time_config(bbr::TIME_CONFIG),
+  m_init_rtt(bbr::INIT_RTT),
+  m_init_bw(bbr::INIT_BW),
+  m_rtt_window_time(Seconds(bbr::RTT_WINDOW_TIME)),
+  m_bw_window_time(bbr::BW_WINDOW_TIME),
+  m_min_cwnd(bbr::MIN_CWND),
+  m_pacing_factor(bbr::PACING_FACTOR),
+  m_steady_factor(bbr::STEADY_FACTOR),
+  m_probe_factor(bbr::PROBE_FACTOR),
+  m_drain_factor(bbr::DRAIN_FACTOR),
+  m_startup_threshold(bbr::STARTUP_THRESHOLD),
+  m_startup_gain(bbr::STARTUP_GAIN),
+  m_send_quantum(bbr::SEND_QUANTUM),
+  m_max_send_quantum(bbr::MAX_SEND_QUANTUM),
+  m_rtt_nochange_limit(Seconds(bbr::RTT_NOCHANGE_LIMIT)),
+  m_probe_rtt_min_time(Seconds(bbr::PROBE_RTT_MIN_TIME)) {
+
+  BBR_LOG_FUNCTION(this);
+  BBR_LOG_INFO(this << "  BBR' version: v" << bbr::VERSION);
+}
 
-  // Constant in "tcp-socket-base.h"
-  if (PACING_CONFIG == NO_PACING) 
-    NS_LOG_INFO(this << "  Note: BBR' configured with pacing NO_PACING.");
+// Enter first state and log configuration (once attributes are set).
+void TcpBbr::NotifyConstructionCompleted(void) {
+  TcpCongestionOps::NotifyConstructionCompleted();
 
-  // First state is STARTUP.
+  // First state is STARTUP (after attributes set, so uses StartupGain).
   m_machine.changeState(&m_state_startup);
+
+  // Attributes (defaults in "tcp-bbr.h")
+  BBR_LOG_INFO(this << "  INIT_RTT: " << m_init_rtt.GetSeconds() << " sec");
+  BBR_LOG_INFO(this << "  INIT_BW: " << m_init_bw << " Mb/s");
+  BBR_LOG_INFO(this << "  RTT_WINDOW_TIME: " << m_rtt_window_time.GetSeconds() << " sec");
+  BBR_LOG_INFO(this << "  BW_WINDOW_TIME: " << m_bw_window_time << " rtts");
+  BBR_LOG_INFO(this << "  MIN_CWND: " << m_min_cwnd << " bytes");
+  BBR_LOG_INFO(this << "  STARTUP_THRESHOLD: " << m_startup_threshold);
+  BBR_LOG_INFO(this << "  STARTUP_GAIN: " << m_startup_gain);
+  BBR_LOG_INFO(this << "  STEADY_FACTOR: " << m_steady_factor);
+  BBR_LOG_INFO(this << "  PROBE_FACTOR: " << m_probe_factor);
+  BBR_LOG_INFO(this << "  DRAIN_FACTOR: " << m_drain_factor);
+  BBR_LOG_INFO(this << "  PACING_FACTOR: " << m_pacing_factor);
+  BBR_LOG_INFO(this << "  SEND_QUANTUM: " << m_send_quantum);
+  BBR_LOG_INFO(this << "  RTT_NOCHANGE_LIMIT: " << m_rtt_nochange_limit.GetSeconds() << " sec");
+  BBR_LOG_INFO(this << "  PROBE_RTT_MIN_TIME: " << m_probe_rtt_min_time.GetSeconds() << " sec");
+
+  // Timing config (used for culling BW window).
+  if (m_time_config == bbr::WALLCLOCK_TIME) 
+    BBR_LOG_INFO("TIME_CONFIG: WALLCLOCK_TIME - BW window culling with wallclock time.");
+  else if (m_time_config == bbr::PACKET_TIME) 
+    BBR_LOG_INFO("TIME_CONFIG: PACKET_TIME - BW window culling with packet time.");
+  else  {
+    BBR_LOG_INFO("WARNING! Unknown TIME_CONFIG: " << m_time_config);
+    BBR_LOG_INFO("BW window culling with packet time.");
+  }
 }
 
 // Copy constructor.
@@ -95,26 +128,56 @@ TcpBbr::TcpBbr(const TcpBbr &sock) :
   m_pacing_gain(0.0),
   m_cwnd_gain(0.0),
   m_round(0),
-  m_delivered(0),
   m_next_round_delivered(0),
+  m_delivered_ack(0),
+  m_delivered_credit(0),
+  m_sacked_bytes(0),
+  m_sack_seen(false),
   m_bytes_in_flight(0),
   m_min_rtt_change(Time(0)),
+  m_filled_pipe(false),
   m_cwnd(0.0),
   m_prior_cwnd(0.0), 
   m_packet_conservation(Time(0)),
-  m_in_retrans_seq(false),
-  m_retrans_seq(0),
   m_machine(this),
   m_state_startup(this),
   m_state_drain(this),
   m_state_probe_bw(this),
-  m_state_probe_rtt(this) {  
-  NS_LOG_FUNCTION("[copy constructor]" << this << &sock);
+  m_state_probe_rtt(this),
+  m_pacing_config(sock.m_pacing_config),
+  m_rng(CreateObject<UniformRandomVariable>()),
+  m_time_config(sock.m_time_config),
+  m_init_rtt(sock.m_init_rtt),
+  m_init_bw(sock.m_init_bw),
+  m_rtt_window_time(sock.m_rtt_window_time),
+  m_bw_window_time(sock.m_bw_window_time),
+  m_min_cwnd(sock.m_min_cwnd),
+  m_pacing_factor(sock.m_pacing_factor),
+  m_steady_factor(sock.m_steady_factor),
+  m_probe_factor(sock.m_probe_factor),
+  m_drain_factor(sock.m_drain_factor),
+  m_startup_threshold(sock.m_startup_threshold),
+  m_startup_gain(sock.m_startup_gain),
+  m_send_quantum(sock.m_send_quantum),
+  m_max_send_quantum(sock.m_max_send_quantum),
+  m_rtt_nochange_limit(sock.m_rtt_nochange_limit),
+  m_probe_rtt_min_time(sock.m_probe_rtt_min_time) {  
+  BBR_LOG_FUNCTION("[copy constructor]" << this << &sock);
+  // m_rng on its own (automatic) stream, not original's, so accepted
+  // sockets don't all pick the same phases.  Fix with AssignStreams().
 }
 
 // Default destructor.
 TcpBbr::~TcpBbr(void) {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
+}
+
+// Assign fixed random variable stream (for PROBE_BW start phase),
+// so runs are reproducible.  Return number of streams assigned (1).
+int64_t TcpBbr::AssignStreams(int64_t stream) {
+  BBR_LOG_FUNCTION(this << stream);
+  m_rng -> SetStream(stream);
+  return 1;
 }
 
 // Get type id.
@@ -122,27 +185,150 @@ TypeId TcpBbr::GetTypeId(void) {
   static TypeId tid = TypeId("ns3::TcpBbr")
     .SetParent<TcpCongestionOps>()
     .SetGroupName("Internet")
-    .AddConstructor<TcpBbr>();
+    .AddConstructor<TcpBbr>()
+    .AddAttribute("TimeConfig",
+                  "Time for culling BW window (packet-timed or wall-clock RTTs)",
+                  EnumValue(bbr::TIME_CONFIG),
+                  MakeEnumAccessor(&TcpBbr::m_time_config),
+                  MakeEnumChecker(bbr::PACKET_TIME, "PacketTime",
+                                  bbr::WALLCLOCK_TIME, "WallclockTime"))
+    .AddAttribute("InitRtt",
+                  "RTT used before any RTT estimates",
+                  TimeValue(bbr::INIT_RTT),
+                  MakeTimeAccessor(&TcpBbr::m_init_rtt),
+                  MakeTimeChecker(Time(0)))
+    .AddAttribute("InitBw",
+                  "BW (in Mb/s) used before any BW estimates",
+                  DoubleValue(bbr::INIT_BW),
+                  MakeDoubleAccessor(&TcpBbr::m_init_bw),
+                  MakeDoubleChecker<double>(0))
+    .AddAttribute("RttWindowTime",
+                  "Length of window for min RTT",
+                  TimeValue(Seconds(bbr::RTT_WINDOW_TIME)),
+                  MakeTimeAccessor(&TcpBbr::m_rtt_window_time),
+                  MakeTimeChecker(Time(0)))
+    .AddAttribute("BwWindowTime",
+                  "Length of window for max BW (in RTTs)",
+                  IntegerValue(bbr::BW_WINDOW_TIME),
+                  MakeIntegerAccessor(&TcpBbr::m_bw_window_time),
+                  MakeIntegerChecker<int>(1))
+    .AddAttribute("MinCwnd",
+                  "Minimum congestion window (in bytes)",
+                  UintegerValue(bbr::MIN_CWND),
+                  MakeUintegerAccessor(&TcpBbr::m_min_cwnd),
+                  MakeUintegerChecker<uint32_t>())
+    .AddAttribute("PacingFactor",
+                  "Factor of BW to pace at when pacing gain is 1",
+                  DoubleValue(bbr::PACING_FACTOR),
+                  MakeDoubleAccessor(&TcpBbr::m_pacing_factor),
+                  MakeDoubleChecker<float>(0))
+    .AddAttribute("SteadyFactor",
+                  "PROBE_BW steady gain",
+                  DoubleValue(bbr::STEADY_FACTOR),
+                  MakeDoubleAccessor(&TcpBbr::m_steady_factor),
+                  MakeDoubleChecker<float>(0))
+    .AddAttribute("ProbeFactor",
+                  "PROBE_BW gain added when probing",
+                  DoubleValue(bbr::PROBE_FACTOR),
+                  MakeDoubleAccessor(&TcpBbr::m_probe_factor),
+                  MakeDoubleChecker<float>(0))
+    .AddAttribute("DrainFactor",
+                  "PROBE_BW gain removed when draining",
+                  DoubleValue(bbr::DRAIN_FACTOR),
+                  MakeDoubleAccessor(&TcpBbr::m_drain_factor),
+                  MakeDoubleChecker<float>(0))
+    .AddAttribute("StartupThreshold",
+                  "BW growth per round below which STARTUP exits",
+                  DoubleValue(bbr::STARTUP_THRESHOLD),
+                  MakeDoubleAccessor(&TcpBbr::m_startup_threshold),
+                  MakeDoubleChecker<float>(1))
+    .AddAttribute("StartupGain",
+                  "Pacing and cwnd gain in STARTUP",
+                  DoubleValue(bbr::STARTUP_GAIN),
+                  MakeDoubleAccessor(&TcpBbr::m_startup_gain),
+                  MakeDoubleChecker<float>(1))
+    .AddAttribute("SendQuantum",
+                  "If true, TCP pacing sends bursts of send quantum bytes",
+                  BooleanValue(bbr::SEND_QUANTUM),
+                  MakeBooleanAccessor(&TcpBbr::m_send_quantum),
+                  MakeBooleanChecker())
+    .AddAttribute("MaxSendQuantum",
+                  "Maximum send quantum (in bytes)",
+                  UintegerValue(bbr::MAX_SEND_QUANTUM),
+                  MakeUintegerAccessor(&TcpBbr::m_max_send_quantum),
+                  MakeUintegerChecker<uint32_t>())
+    .AddAttribute("RttNoChangeLimit",
+                  "Time without new min RTT before entering PROBE_RTT",
+                  TimeValue(Seconds(bbr::RTT_NOCHANGE_LIMIT)),
+                  MakeTimeAccessor(&TcpBbr::m_rtt_nochange_limit),
+                  MakeTimeChecker(Time(0)))
+    .AddAttribute("ProbeRttMinTime",
+                  "Minimum time in PROBE_RTT",
+                  TimeValue(Seconds(bbr::PROBE_RTT_MIN_TIME)),
+                  MakeTimeAccessor(&TcpBbr::m_probe_rtt_min_time),
+                  MakeTimeChecker(Time(0)))
+    .AddTraceSource("PacingGain",
+                    "Pacing gain",
+                    MakeTraceSourceAccessor(&TcpBbr::m_pacing_gain),
+                    "ns3::TracedValueCallback::Double")
+    .AddTraceSource("CwndGain",
+                    "Cwnd gain",
+                    MakeTraceSourceAccessor(&TcpBbr::m_cwnd_gain),
+                    "ns3::TracedValueCallback::Double")
+    .AddTraceSource("TargetCwnd",
+                    "Target cwnd (in bytes)",
+                    MakeTraceSourceAccessor(&TcpBbr::m_cwnd),
+                    "ns3::TracedValueCallback::Double")
+    .AddTraceSource("MaxBw",
+                    "Max BW estimate in window (in Mb/s)",
+                    MakeTraceSourceAccessor(&TcpBbr::m_max_bw),
+                    "ns3::TracedValueCallback::Double")
+    .AddTraceSource("MinRtt",
+                    "Min RTT estimate in window",
+                    MakeTraceSourceAccessor(&TcpBbr::m_min_rtt),
+                    "ns3::TracedValueCallback::Time")
+    .AddTraceSource("Round",
+                    "Packet-timed round count",
+                    MakeTraceSourceAccessor(&TcpBbr::m_round),
+                    "ns3::TracedValueCallback::Int32")
+    .AddTraceSource("State",
+                    "BBR' state changes (old, new)",
+                    MakeTraceSourceAccessor(&TcpBbr::m_state_trace),
+                    "ns3::TcpBbr::StateCallback")
+    .AddTraceSource("RateSample",
+                    "Delivery rate sample for each ack delivering data",
+                    MakeTraceSourceAccessor(&TcpBbr::m_rate_sample_trace),
+                    "ns3::TcpBbr::RateSampleCallback");
   return tid;
 }
 
 // Get name of congestion control algorithm.
 std::string TcpBbr::GetName() const {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
   return "TcpBbr";
 }
 
+// Return current state (e.g., to seed "State" trace sinks).
+bbr::bbr_state TcpBbr::getState() const {
+  return m_machine.getStateType();
+}
+
+// Return max BW of window (Mb/s, e.g., to seed "MaxBw" trace sinks).
+double TcpBbr::getMaxBw() const {
+  return m_max_bw;
+}
+
 // Copy BBR' congestion control algorithm across socket.
 Ptr<TcpCongestionOps> TcpBbr::Fork() {
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
   return CopyObject<TcpBbr> (this);
 }
 
 // BBR' ignores calls to increase window.
 // tcb = internal congestion state
 void TcpBbr::IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segs_acked) {
-  NS_LOG_FUNCTION(this << tcb << segs_acked);
-  NS_LOG_INFO(this << "  Ignored.");
+  BBR_LOG_FUNCTION(this << tcb << segs_acked);
+  BBR_LOG_INFO(this << "  Ignored.");
   return;
 }
 
@@ -150,8 +336,8 @@ void TcpBbr::IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segs_acked) {
 // tcb = transmission control block
 uint32_t TcpBbr::GetSsThresh(Ptr<const TcpSocketState> tcb,
                              uint32_t b_in_flight) {
-  NS_LOG_FUNCTION(this << tcb << b_in_flight);
-  NS_LOG_INFO(this << "  Ignored.  Returning max (65535).");
+  BBR_LOG_FUNCTION(this << tcb << b_in_flight);
+  BBR_LOG_INFO(this << "  Ignored.  Returning max (65535).");
   return 65535;
 }
 
@@ -164,20 +350,45 @@ uint32_t TcpBbr::GetSsThresh(Ptr<const TcpSocketState> tcb,
 void TcpBbr::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t packets_acked,
                        const Time &rtt) {
 
-  NS_LOG_FUNCTION(this << packets_acked << rtt);
+  BBR_PROFILE(bbr::PROFILE_PKTS_ACKED);
+  BBR_LOG_FUNCTION(this << packets_acked << rtt);
+
+  // Pacing config is socket attribute.
+  m_pacing_config = tcb -> GetPacingConfig();
+
+  // Use version specialised for configs (for BBR', pacing only
+  // matters as pacing or not).
+  if (m_time_config == bbr::WALLCLOCK_TIME) {
+    if (m_pacing_config == NO_PACING)
+      pktsAcked<bbr::NotPaced, bbr::WallclockTime>(tcb, packets_acked, rtt);
+    else
+      pktsAcked<bbr::TcpPaced, bbr::WallclockTime>(tcb, packets_acked, rtt);
+  } else {
+    if (m_pacing_config == NO_PACING)
+      pktsAcked<bbr::NotPaced, bbr::PacketTime>(tcb, packets_acked, rtt);
+    else
+      pktsAcked<bbr::TcpPaced, bbr::PacketTime>(tcb, packets_acked, rtt);
+  }
+}
+
+// On receiving ack, as PktsAcked(), for pacing policy P and timing
+// policy T (configs known at compile time).
+template <class P, class T>
+void TcpBbr::pktsAcked(Ptr<TcpSocketState> tcb, uint32_t packets_acked,
+                       const Time &rtt) {
 
   ////////////////////////////////////////////
   // UPDATE TCP CONGESTION WINDOW (CWND)
 
-  uint32_t bytes_delivered = packets_acked * 1500;
+  uint32_t bytes_delivered = updateDelivered(tcb);
 
   // If in Fast Recovery, target cwnd was set in CongestionStateSet().
   if (tcb->m_congState == TcpSocketState::CA_RECOVERY) {
     // If in first RTT of Fast Recovery, modulate cwnd.
     if (m_packet_conservation > Simulator::Now()) {
-      NS_LOG_LOGIC(this << "  Modulating cwnd until: " <<
+      BBR_LOG_LOGIC(this << "  Modulating cwnd until: " <<
                   m_packet_conservation.GetSeconds());
-      NS_LOG_LOGIC(this << "  m_cwnd: " << m_cwnd <<
+      BBR_LOG_LOGIC(this << "  m_cwnd: " << m_cwnd <<
                   "  bytes_in_flight: " << m_bytes_in_flight <<
                   "  bytes_delivered: " << bytes_delivered);
       if ((m_bytes_in_flight + bytes_delivered) > m_cwnd)
@@ -185,12 +396,12 @@ void TcpBbr::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t packets_acked,
     }
   } else {
     // Not in Fast Recovery, so re-compute target cwnd.
-    updateTargetCwnd();
+    updateTargetCwnd<P, T>();
   }
 
   // If growing cwnd, do so conservatively.
   if (tcb -> m_cWnd < m_cwnd) {
-    NS_LOG_LOGIC(this << "  Increasing cwnd by: " << bytes_delivered);
+    BBR_LOG_LOGIC(this << "  Increasing cwnd by: " << bytes_delivered);
     tcb -> m_cWnd = tcb -> m_cWnd + bytes_delivered;
   } else
     // If shrinking cwnd, adjust immediately.
@@ -199,143 +410,103 @@ void TcpBbr::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t packets_acked,
   ////////////////////////////////////////////
   // STORE RTT
   if (rtt.IsZero() || rtt.IsNegative()) {
-    NS_LOG_WARN("RTT measured is zero (or less)! Not stored.");
+    BBR_LOG_WARN("RTT measured is zero (or less)! Not stored.");
     return;
   }
 
   // See if changed minimum RTT (to decide when to PROBE_RTT).
   Time now = Simulator::Now();
   Time min_rtt = getRTT();
-  if (rtt < getRTT()) {
-    NS_LOG_LOGIC(this << "  New min RTT: " << 
+  if (rtt < min_rtt) {
+    BBR_LOG_LOGIC(this << "  New min RTT: " << 
                 rtt << " sec (was: " << min_rtt.GetSeconds() << ")");
     m_min_rtt_change = now;  
   }
 
   // Add to RTT window.
-  m_rtt_window[now] = rtt;
-
-  // Upon first RTT, call update() to initialize timer.
-  if (m_rtt_window.size() == 1) {
-    NS_LOG_LOGIC(this << "  First rtt, calling update() to init.");
-    m_machine.update();
-  }
+  m_rtt_window.update(rtt, now, m_rtt_window_time);
 
   ////////////////////////////////////////////
   // BW ESTIMATION
   // Based on [CCYJ17b]:
   // Cheng et al., "Delivery Rate Estimation", IETF Draft, Jul 3, 2017
   //
-  //                                (outstanding)
-  // TCP Window: (latest ACKed) W_a [W_1 ... W_n] W_s (next sent)
-  //
-  // Send() 
-  //   Record W_a
-  //   Record time W_t
-  //   Send W_s
+  // Send()
+  //   Stamp segment with delivered, delivered time, first sent time
   // PktsAcked()
-  //   Record time W_t'
-  //   Compute BW: bw = (W_s - W_a) / (W_t' - W_t)
+  //   Deliver bytes ACKed, retiring segments cumulatively ACKed (above)
+  //   Compute BW: bw = delivered / max(send_elapsed, ack_elapsed)
   //   Update data structures
 
-  SequenceNumber32 ack = tcb->m_lastAckedSeq;  // W_s
-  now = Simulator::Now();                      // W_t'
-  bbr::packet_struct packet;
-
-  // Update packet-timed RTT.
-  m_delivered += tcb->m_segmentSize;
-  packet.delivered = -1;
-  for (auto it = m_pkt_window.begin(); it != m_pkt_window.end(); it++) {
-    if (it->sent == ack)
-      packet = *it;
-  }
-  if (packet.delivered >= m_next_round_delivered) {
-    m_next_round_delivered = m_delivered;
+  SequenceNumber32 ack = tcb->m_lastAckedSeq;
+  bbr::rate_sample rs;
+  bool valid = m_rate.generate(getRTT(), rs);
+  if (rs.has_data)
+    m_rate_sample_trace(rs);
+
+  // Update packet-timed RTT (round ends when segment sent at start
+  // of round is delivered).
+  bool new_round = false;
+  if (rs.has_data && rs.prior_delivered >= m_next_round_delivered) {
+    m_next_round_delivered = m_rate.getDelivered();
     m_round++;
-    NS_LOG_LOGIC(this << " New packet-timed RTT.  Round: " << m_round);
-  }
-
-  // See if retransmission sequence should end.
-  bool do_est_bw = true;
-  if (m_in_retrans_seq) {
-    NS_LOG_LOGIC(this << "  In retransmission sequence: " << m_retrans_seq);
-    if (ack != m_retrans_seq) {
-      m_in_retrans_seq = false;
-      NS_LOG_LOGIC(this << "  Retransmission sequence ended: " << ack);
-    }
-    // Don't estimate BW if in retrans sequence (or just ending_.
-    do_est_bw = false; 
+    new_round = true;
+    BBR_LOG_LOGIC(this << " New packet-timed RTT.  Round: " << m_round);
   }
 
-  // If ack not in list (or list empty), unknown when sent so ignore.
-  // This happens most often during retransmission sequences.
-  if (m_pkt_window.size() == 0) {
-    NS_LOG_LOGIC(this << " Packet window size is zero.");
-    return; // Nothing more to do.
-  }
-  auto first = m_pkt_window.begin()->sent;
-  if (ack < first) {
-    NS_LOG_LOGIC(this << " Not found.  Ack: "<< ack <<
-                "  Earliest in list: "<< first);
+  // If no segment delivered (e.g., dupack), unknown when sent so ignore.
+  if (!rs.has_data) {
+    BBR_LOG_LOGIC(this << " No segment delivered.  Ack: "<< ack);
     return;  // Nothing more to do.
   }
 
-  // Find oldest ack in window, <= current.
-  packet.sent = 0;
-  packet.time = Time(0);
-  for (auto it = m_pkt_window.begin(); it != m_pkt_window.end(); it++)
-    if (it->sent <= ack && it->sent > packet.sent)
-      packet = *it;  // W_a
-
-  // Remove all entries with acks <= current from window.
-  for (unsigned int i=0; i < m_pkt_window.size(); )
-    if (m_pkt_window[i].sent <= packet.sent) 
-      m_pkt_window.erase(m_pkt_window.begin() + i);
+  // Add BW to window (configured with either WALLCLOCK or PACKET time).
+  // If application limited, BW is low because of application, so only
+  // add if not less than current max (see Section 4.1.1.4 in [CCYJ17]).
+  double bw_est = rs.delivery_rate;
+  if (valid && rs.is_app_limited && bw_est < getBW<T>()) {
+    BBR_LOG_LOGIC(this << "  App limited BW not added: " << bw_est);
+    valid = false;
+  }
+  if (valid) {
+    if (T::config == bbr::WALLCLOCK_TIME)
+      m_bw_time_window.update(bw_est, now, getRTT() * m_bw_window_time);
     else
-      i++;
-
-  // Estimate BW.
-  double bw_est = 0.0;
-  if (do_est_bw) {
-
-    // Estimate BW: bw = (W_s - W_a) / (W_t' - W_t)
-    bw_est = (ack - packet.acked) /
-             (now.GetSeconds() - packet.time.GetSeconds());
-    bw_est *= 8;          // Convert to b/s.
-    bw_est /= 1000000;    // Convert to Mb/s.
-
-    // Add to BW window.
-    bbr::bw_struct bw;
-    bw.bw_est = bw_est;
-    bw.time = now;
-    bw.round = m_round;
-    m_bw_window.push_back(bw);
+      m_bw_window.update(bw_est, m_round, m_bw_window_time);
   }
 
+  // Update state machine once per packet-timed round.
+  if (new_round)
+    m_machine.update();
+
+  // Traced only if changed.
+  m_max_bw = getBW<T>();
+  m_min_rtt = getRTT();
+
   ////////////////////////////////////////////
   // COMPUTE AND SET PACING RATE.
   // Set pacing rate (in Mb/s), adjusted by gain.
-  double pacing_rate = getBW() * m_pacing_gain;
+  double pacing_rate = getBW<T>() * m_pacing_gain;
 
   // There may be some advantages to pacing at just under BW.
   // Either way, this is adjustable in header file.
   if (m_pacing_gain == 1)
-    pacing_rate *= bbr::PACING_FACTOR;
+    pacing_rate *= m_pacing_factor;
   
   if (pacing_rate < 0)
     pacing_rate = 0.0;
 
-  if (PACING_CONFIG != NO_PACING) {
+  if (P::config != NO_PACING) {
 
     // If in PROBE_RTT, minimize pacing rate since TCP pacing
     // might have built-up queue.
     if (m_machine.getStateType() == bbr::PROBE_RTT_STATE) {
-      double probe_rtt_pacing_rate = bbr::MIN_CWND;   // Bytes (B).
+      double probe_rtt_pacing_rate = m_min_cwnd;   // Bytes (B).
       probe_rtt_pacing_rate /=  min_rtt.GetSeconds(); // B/s.
       probe_rtt_pacing_rate *= 8;                     // Convert to b/s.
       probe_rtt_pacing_rate /= 1000000;               // Convert to Mb/s.
-      NS_LOG_LOGIC(this << " In PROBE_RTT," <<
-                   "  bbr::MIN_CWND: " << bbr::MIN_CWND <<
+      BBR_LOG_LOGIC(this << " In PROBE_RTT," <<
+                   "  min cwnd: " << m_min_cwnd <<
                    "  min_rtt: " << min_rtt.GetSeconds() << 
                    "  pacing rate: " << pacing_rate << 
                    "  probe_rtt pacing rate: " << probe_rtt_pacing_rate);
@@ -345,20 +516,22 @@ void TcpBbr::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t packets_acked,
     
     // Set rate.
     tcb -> SetPacingRate(pacing_rate);
+
+    // Set send quantum, if sending in bursts.
+    if (m_send_quantum)
+      tcb -> SetSendQuantum(getSendQuantum(pacing_rate, tcb -> m_segmentSize));
   }
 
   ////////////////////////////////////////////
   // Report data.
-  NS_LOG_LOGIC(this << 
+  BBR_LOG_LOGIC(this << 
               " m_round: " << m_round <<
-              "  W_s: " << ack <<
-              "  W_a: " << packet.acked <<
-              "  W_t': " << now.GetSeconds() <<
-              "  W_t: " << packet.time.GetSeconds());
-  NS_LOG_LOGIC(this << "  byte-diff: " << (ack - packet.acked));
-  NS_LOG_LOGIC(this << "  time-diff: " <<
-              (now.GetSeconds() - packet.time.GetSeconds()));
-  NS_LOG_INFO(this << "  DATA rtt: " << rtt.GetSeconds() << "  " <<
+              "  ack: " << ack <<
+              "  delivered: " << rs.delivered <<
+              "  send_elapsed: " << rs.send_elapsed.GetSeconds() <<
+              "  ack_elapsed: " << rs.ack_elapsed.GetSeconds() <<
+              "  app_limited: " << rs.is_app_limited);
+  BBR_LOG_INFO(this << "  DATA rtt: " << rtt.GetSeconds() << "  " <<
               "pacing-gain " << m_pacing_gain <<  "  " <<
               "pacing-rate " << pacing_rate << " Mb/s  " <<
               "bw: " << bw_est << " Mb/s  " <<
@@ -371,59 +544,154 @@ void TcpBbr::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t packets_acked,
 // tsb = tcp socket base
 // tcb = transmission control block
 void TcpBbr::Send(Ptr<TcpSocketBase> tsb, Ptr<TcpSocketState> tcb,
-                  SequenceNumber32 seq, bool isRetrans) {
+                  SequenceNumber32 seq, uint32_t size, bool isRetrans) {
+
+  BBR_PROFILE(bbr::PROFILE_SEND);
+  BBR_LOG_FUNCTION(this);
 
-  NS_LOG_FUNCTION(this);
+  // Pacing config is socket attribute.
+  m_pacing_config = tcb -> GetPacingConfig();
 
   // Get the bytes in flight (needed for STARTUP/CA_RECOVERY).
   m_bytes_in_flight = tsb -> BytesInFlight();
 
-  // If retransmission, start sequence (PktsAcked() finds end of sequence).
-  if (isRetrans) {
-    m_in_retrans_seq = true;
-    m_retrans_seq = seq;
-    NS_LOG_LOGIC(this << "  Starting retrans sequence: " << seq);
+  // If first data sent, ack of it is first counted as delivered.
+  if (m_rate.getDelivered() == 0 && m_rate.empty())
+    m_delivered_ack = seq;
+
+  // Stamp segment for BW est (in PktsAcked()), re-stamping if
+  // retransmission.
+  m_rate.onSend(seq, size, Simulator::Now());
+
+  BBR_LOG_LOGIC(this << "  seq: " << seq << "  size: " << size <<
+               "  retrans: " << isRetrans);
+}
+
+// When application has no more data to send:
+// - mark rate samples application limited
+// - if idle, restart pacing at BW estimate
+// tsb = tcp socket base
+// tcb = transmission control block
+void TcpBbr::AppLimited(Ptr<TcpSocketBase> tsb, Ptr<TcpSocketState> tcb) {
+
+  BBR_LOG_FUNCTION(this);
+
+  // Pacing config is socket attribute.
+  m_pacing_config = tcb -> GetPacingConfig();
+
+  // Samples until bytes in flight are delivered are app limited.
+  uint32_t in_flight = tsb -> BytesInFlight();
+  m_rate.setAppLimited(in_flight);
+
+  // Restart from idle (see Section 4.3.4.4 in [CCYJ17]): in PROBE_BW,
+  // pace at BW estimate (no gain) so data sent after idle goes out
+  // at full rate.  No acks while idle, so rate holds until sending.
+  double bw = getBW();
+  if (in_flight == 0 && m_pacing_config != NO_PACING && bw > 0 &&
+      m_machine.getStateType() == bbr::PROBE_BW_STATE) {
+    BBR_LOG_LOGIC(this << "  Idle.  Restart pacing rate: " << bw);
+    tcb -> SetPacingRate(bw);
   }
+}
 
-  // If not in retrans sequence, record info for BW est (in PktsAcked()).
-  if (!m_in_retrans_seq) {
+// On SACK (before PktsAcked() for same ack):
+// - deliver segments newly SACKed, for BW est
+// tcb = transmission control block
+void TcpBbr::Sacked(Ptr<TcpSocketState> tcb,
+                    const TcpOptionSack::SackList &list) {
 
-    // Get last sequence number ACKed.
-    bbr::packet_struct p;
-    p.acked = tcb -> m_lastAckedSeq;
-    p.sent = seq;
-    p.time = Simulator::Now();
-    p.delivered = m_delivered;
-    m_pkt_window.push_back(p);
-  
-    NS_LOG_LOGIC(this << "  Last acked: " << p.acked <<
-                " Next sequence: " << p.sent);
-  } else {
-    NS_LOG_LOGIC(this << "  seq: " << seq <<
-                "  In retrans sequence: " << m_retrans_seq);
+  BBR_LOG_FUNCTION(this);
+
+  m_sack_seen = true;
+  Time now = Simulator::Now();
+  for (TcpOptionSack::SackList::const_iterator it = list.begin();
+       it != list.end(); ++it)
+    m_sacked_bytes += m_rate.onSack(it -> first, it -> second, now);
+
+  BBR_LOG_LOGIC(this << "  SACK blocks: " << list.size() <<
+               "  SACKed: " << m_sacked_bytes);
+}
+
+// Return bytes newly delivered by ack (cumulatively acked or SACKed),
+// delivering them for BW est.
+// As per [CCYJ17b] (C.delivered), counts bytes cumulatively acked and
+// SACKed.  Without SACK, a dupack means a segment past the hole was
+// delivered, so is counted as 1 MSS.  Bytes SACKed or counted for
+// dupacks are not counted again when cumulatively acked.
+uint32_t TcpBbr::updateDelivered(Ptr<TcpSocketState> tcb) {
+  SequenceNumber32 ack = tcb -> m_lastAckedSeq;
+  uint32_t bytes = 0;
+
+  // SACKed bytes already delivered (see Sacked()).
+  m_delivered_credit += m_sacked_bytes;
+
+  if (ack > m_delivered_ack) {
+    // Cumulative ack, less bytes already counted.
+    uint32_t acked = ack - m_delivered_ack;
+    uint32_t credit = std::min(acked, m_delivered_credit);
+    m_delivered_credit -= credit;
+    bytes = acked - credit;
+    m_delivered_ack = ack;
+  } else if (!m_sack_seen) {
+    // Dupack (without SACK).
+    bytes = tcb -> m_segmentSize;
+    m_delivered_credit += bytes;
   }
+
+  // Deliver bytes for rate sample (every ack, even if no RTT).
+  m_rate.onAck(ack, bytes, Simulator::Now());
+
+  BBR_LOG_LOGIC(this << "  Delivered: " << bytes <<
+               "  SACKed: " << m_sacked_bytes <<
+               "  credit: " << m_delivered_credit);
+
+  bytes += m_sacked_bytes;
+  m_sacked_bytes = 0;
+  m_sack_seen = false;
+
+  return bytes;
+}
+
+// Return send quantum (in bytes) for pacing rate (in Mb/s).
+// As per Section 4.2.2 in [CCYJ17]: 1 packet below 1.2 Mb/s, 2 packets
+// below 24 Mb/s, else 1 msec of data, up to 64 KBytes.
+uint32_t TcpBbr::getSendQuantum(double pacing_rate, uint32_t mss) const {
+  if (pacing_rate < 1.2)
+    return mss;
+  if (pacing_rate < 24)
+    return 2 * mss;
+  double bytes = pacing_rate * 1000000 / 8 * 0.001; // 1 msec at rate.
+  return std::min((uint32_t) bytes, m_max_send_quantum);
 }
 
 // Return bandwidth (maximum of window, in Mb/s).
 // Return -1 if no BW estimates.
+double TcpBbr::getBW() const {
+  if (m_time_config == bbr::WALLCLOCK_TIME)
+    return getBW<bbr::WallclockTime>();
+  else
+    return getBW<bbr::PacketTime>();
+}
+
+// Return bandwidth, as getBW(), for timing policy T.
+template <class T>
 double TcpBbr::getBW() const {
   double max_bw = 0;
 
-  NS_LOG_FUNCTION(this);
+  if (T::config == bbr::WALLCLOCK_TIME && !m_bw_time_window.empty())
 
-  if (m_bw_window.size() == 0)
+    // Max BW in window tracked by filter (wallclock time).
+    max_bw = m_bw_time_window.get();
 
-    // Special case if no BW estimates.
-    max_bw = -1.0;
+  else if (T::config == bbr::PACKET_TIME && !m_bw_window.empty())
+
+    // Max BW in window tracked by filter (packet time).
+    max_bw = m_bw_window.get();
 
   else
 
-    // Find max BW in window.
-    for (auto it = m_bw_window.begin(); it != m_bw_window.end(); it++)
-      max_bw = std::max(max_bw, it->bw_est);
-  
-  NS_LOG_INFO(this << "  DATA bws in window: " << m_bw_window.size() <<
-              "  max_bw: " << max_bw);
+    // Special case if no BW estimates.
+    max_bw = -1.0;
 
   // Return it.
   return max_bw;
@@ -432,23 +700,17 @@ double TcpBbr::getBW() const {
 // Return round-trip time (min of window, in seconds).
 // Return -1 if no RTT estimates.
 Time TcpBbr::getRTT() const {
-  Time min_rtt = Time::Max();
+  Time min_rtt;
 
-  NS_LOG_FUNCTION(this);
-
-  if (m_rtt_window.size() == 0)
+  if (m_rtt_window.empty())
 
     // Special case if no RTT estimates.
     min_rtt = Time(-1.0);
 
   else
     
-    // Find minimum RTT in window.
-    for (auto it = m_rtt_window.begin(); it != m_rtt_window.end(); it++)
-      min_rtt = std::min(min_rtt, it->second);
-
-  NS_LOG_INFO(this << "  DATA rtts in window: " << m_rtt_window.size() <<
-              "  min_rtt: " << min_rtt.GetSeconds());
+    // Min RTT in window tracked by filter.
+    min_rtt = m_rtt_window.get();
 
   // Return it.
   return min_rtt;
@@ -456,20 +718,28 @@ Time TcpBbr::getRTT() const {
 
 // Return bandwidth-delay product (in Mbits).
 double TcpBbr::getBDP() const {
-  NS_LOG_FUNCTION(this);
+  if (m_time_config == bbr::WALLCLOCK_TIME)
+    return getBDP<bbr::WallclockTime>();
+  else
+    return getBDP<bbr::PacketTime>();
+}
+
+// Return bandwidth-delay product, as getBDP(), for timing policy T.
+template <class T>
+double TcpBbr::getBDP() const {
   Time rtt = getRTT();
   if (rtt.IsNegative())
-    rtt = bbr::INIT_RTT;
-  double bw = getBW();
+    rtt = m_init_rtt;
+  double bw = getBW<T>();
   if (bw < 0)
-    bw = bbr::INIT_BW;
+    bw = m_init_bw;
   return (double) (rtt.GetSeconds() * bw);
 }
 
 // Remove BW estimates that are too old (greater than 10 RTTs).
 void TcpBbr::cullBWwindow() {
 
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 
   // If no BW estimates, leave window unchanged.
   double bw = getBW();
@@ -481,88 +751,67 @@ void TcpBbr::cullBWwindow() {
   if (rtt.IsNegative())
     return;
 
-  // Compute time delta, 10 RTTs ago until now.
+  // Compute time window, 10 RTTs ago until now.
   Time now = Simulator::Now();
-  Time time_delta = now - rtt * bbr::BW_WINDOW_TIME;
-  int round_delta = m_round - bbr::BW_WINDOW_TIME;
-  
-  // Erase any values that are too old.
-  auto it = m_bw_window.begin();
-  while (it != m_bw_window.end()) {
-
-    // Configured with either WALLCLOCK or PACKET time.
-    if (bbr::TIME_CONFIG == bbr::WALLCLOCK_TIME) { // Use wallclock time.
-      if (it -> time < time_delta)
-        it = m_bw_window.erase(it);
-      else
-        it++;
-    } else {                          // Use packet time.
-      if (it -> round < round_delta)
-        it = m_bw_window.erase(it);
-      else
-        it++;
-    }
-
+  Time time_window = rtt * m_bw_window_time;
+
+  // Expire any values that are too old.
+  // Configured with either WALLCLOCK or PACKET time.
+  if (m_time_config == bbr::WALLCLOCK_TIME) { // Use wallclock time.
+    m_bw_time_window.expire(now, time_window);
+    if (m_bw_time_window.empty())
+      BBR_LOG_LOGIC(this << " BW window empty.");
+    else
+      BBR_LOG_INFO(this << " DATA" <<
+                  "  max_bw: " << m_bw_time_window.get() <<
+                  " [" << m_bw_time_window.getKey().GetSeconds() << ", " <<
+                  now.GetSeconds() << "]");
+  } else {                          // Use packet time.
+    m_bw_window.expire(m_round, m_bw_window_time);
+    if (m_bw_window.empty())
+      BBR_LOG_LOGIC(this << " BW window empty.");
+    else
+      BBR_LOG_INFO(this << " DATA" <<
+                  "  max_bw: " << m_bw_window.get() <<
+                  " [" << m_bw_window.getKey() << ", " << m_round << "]");
   }
-
-  // Log info.
-  int size = m_bw_window.size();
-  if (size == 0)
-    NS_LOG_LOGIC(this << " BW window empty.");
-  else
-    NS_LOG_INFO(this << " DATA" <<
-               "  m_bw_window_size: " << size <<
-                " [" << m_bw_window.begin()->round << ", " <<
-                m_bw_window.rbegin()->round << "]" << 
-                " [" << m_bw_window.begin()->time.GetSeconds() << ", " <<
-                m_bw_window.rbegin()->time.GetSeconds() << "]");
 }
 
 // Remove RTT estimates that are too old (greater than 10 seconds).
 void TcpBbr::cullRTTwindow() {
 
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 
   // If no RTT estimates, leave window unchanged.
   Time rtt = getRTT();
   if (rtt.IsNegative())
     return;
 
-  // Compute time delta, 10 seconds ago until now.
+  // Expire any values that are too old (10 seconds ago until now).
   Time now = Simulator::Now();
-  Time delta = Time(now - bbr::RTT_WINDOW_TIME * 1000000000.0); // Units are nanoseconds.
-
-  // Erase any values that are too old.
-  auto it = m_rtt_window.begin();
-  while (it != m_rtt_window.end()) {
-    if (it -> first < delta)
-      it = m_rtt_window.erase(it);
-    else
-      it++;
-  }
+  m_rtt_window.expire(now, m_rtt_window_time);
  
-  int size = m_rtt_window.size();
-  if (size == 0)
-    NS_LOG_LOGIC(this << " RTT window empty.");
+  if (m_rtt_window.empty())
+    BBR_LOG_LOGIC(this << " RTT window empty.");
   else
-    NS_LOG_INFO(this << " DATA" <<
-                "  m_rtt_window_size: " << size <<
-                " [" << m_rtt_window.begin()->first.GetSeconds() << ", " <<
-                m_rtt_window.rbegin()->first.GetSeconds() << "]");
+    BBR_LOG_INFO(this << " DATA" <<
+                "  min_rtt: " << m_rtt_window.get().GetSeconds() <<
+                " [" << m_rtt_window.getKey().GetSeconds() << ", " <<
+                now.GetSeconds() << "]");
 }
 
 // Return true if should enter PROBE_RTT state.
 bool TcpBbr::checkProbeRTT() {
 
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 
-  // Check if PROBE_BW and min RTT hasn't changed in 10 seconds.
+  // Check if min RTT hasn't changed in limit (10 seconds).  Can enter
+  // from any state (see Section 4.3.5 in [CCYJ17]).
   Time now = Simulator::Now();
-  if (m_machine.getStateType() == bbr::PROBE_BW_STATE &&
-      (now.GetSeconds() - m_min_rtt_change.GetSeconds()) >
-      bbr::RTT_NOCHANGE_LIMIT) {
+  if (m_machine.getStateType() != bbr::PROBE_RTT_STATE &&
+      (now - m_min_rtt_change) > m_rtt_nochange_limit) {
 
-    NS_LOG_LOGIC(this << "  min RTT last changed: " << m_min_rtt_change.GetSeconds());
+    BBR_LOG_LOGIC(this << "  min RTT last changed: " << m_min_rtt_change.GetSeconds());
 
     m_min_rtt_change = now;
 
@@ -577,29 +826,30 @@ bool TcpBbr::checkProbeRTT() {
 void TcpBbr::CongestionStateSet(Ptr<TcpSocketState> tcb,
                         const TcpSocketState::TcpCongState_t new_state) {
 
-  NS_LOG_FUNCTION(this << tcb << new_state);
+  BBR_LOG_FUNCTION(this << tcb << new_state);
+  m_pacing_config = tcb -> GetPacingConfig();
   auto old_state = tcb->m_congState;
-  NS_LOG_LOGIC(this << " old_state: " <<
+  BBR_LOG_LOGIC(this << " old_state: " <<
               TcpSocketState::TcpCongStateName[old_state] <<
               ", new_state: " <<
               TcpSocketState::TcpCongStateName[new_state]);
     
   // Enter RTO --> minimal cwnd.
   if (new_state == TcpSocketState::CA_LOSS) {
-    NS_LOG_LOGIC(this << " Entering RTO (CA_LOSS)");
+    BBR_LOG_LOGIC(this << " Entering RTO (CA_LOSS)");
     m_prior_cwnd = m_cwnd;
     m_cwnd = 1000; // bytes
-    NS_LOG_LOGIC(this << " cwnd: " << m_cwnd);
+    BBR_LOG_LOGIC(this << " cwnd: " << m_cwnd);
   }
 
   // Enter Fast Recovery --> save cwnd.
   // Modulate cwnd for 1 RTT.
   if (new_state == TcpSocketState::CA_RECOVERY) {
-    NS_LOG_LOGIC(this << " Entering Fast Recovery (CA_RECOVERY)");
+    BBR_LOG_LOGIC(this << " Entering Fast Recovery (CA_RECOVERY)");
     m_prior_cwnd = m_cwnd;
     m_cwnd = m_bytes_in_flight + 1;
     m_packet_conservation = Simulator::Now() + getRTT(); // Modulate for 1 RTT.
-    NS_LOG_LOGIC(this << " m_cwnd: " << m_cwnd <<
+    BBR_LOG_LOGIC(this << " m_cwnd: " << m_cwnd <<
                 "  prior_cwnd: " << m_prior_cwnd <<
                 "  packet_cons: " << m_packet_conservation.GetSeconds());
   }
@@ -609,22 +859,24 @@ void TcpBbr::CongestionStateSet(Ptr<TcpSocketState> tcb,
        old_state == TcpSocketState::CA_LOSS) &&
       (new_state != TcpSocketState::CA_RECOVERY &&
        new_state != TcpSocketState::CA_LOSS)) {
-    NS_LOG_LOGIC(this << " Exiting RTO/Fast Recovery (CA_LOSS/CA_RECOVERY)");
+    BBR_LOG_LOGIC(this << " Exiting RTO/Fast Recovery (CA_LOSS/CA_RECOVERY)");
     m_packet_conservation = Simulator::Now(); // Stop packet conservation.
     if (m_prior_cwnd > m_cwnd)
       m_cwnd = m_prior_cwnd;
-    NS_LOG_LOGIC(this << "  m_cwnd: " << m_cwnd <<
+    BBR_LOG_LOGIC(this << "  m_cwnd: " << m_cwnd <<
                 "  prior_cwnd: " << m_prior_cwnd);
   }
 }
 
-// Compute target TCP cwnd (m_cwnd) based on BDP and gain.
+// Compute target TCP cwnd (m_cwnd) based on BDP and gain,
+// for pacing policy P and timing policy T.
+template <class P, class T>
 void TcpBbr::updateTargetCwnd() {
 
-  NS_LOG_FUNCTION(this);
+  BBR_LOG_FUNCTION(this);
 
-  double bdp = getBDP();
-  if (PACING_CONFIG == NO_PACING)
+  double bdp = getBDP<T>();
+  if (P::config == NO_PACING)
     // If no pacing, cwnd is used to control pace.
     m_cwnd = bdp * m_pacing_gain;
   else
@@ -633,14 +885,104 @@ void TcpBbr::updateTargetCwnd() {
   m_cwnd = (m_cwnd * 1000000 / 8); // Mbits to bytes.
 
   // Make sure cwnd not too small (roughly, 4 packets).
-  if (m_cwnd < bbr::MIN_CWND) {
-    NS_LOG_LOGIC(this << "  m_cwnd (bytes): " << m_cwnd <<
-                 "  Boosting to (bytes): " << bbr::MIN_CWND);
-    m_cwnd = bbr::MIN_CWND; // In bytes.
+  if (m_cwnd < m_min_cwnd) {
+    BBR_LOG_LOGIC(this << "  m_cwnd (bytes): " << m_cwnd <<
+                 "  Boosting to (bytes): " << m_min_cwnd);
+    m_cwnd = m_min_cwnd; // In bytes.
   }
 
   // Log info.
-  NS_LOG_INFO(this << "  DATA bdp (Mbits): " << bdp <<
+  BBR_LOG_INFO(this << "  DATA bdp (Mbits): " << bdp <<
               "  bdp (bytes): " << bdp * 1000000 / 8 <<
               "  m_cwnd (bytes): " << m_cwnd);
 }
+
+///////////////////////////////////////////////
+// BBR' with configs fixed at compile time.
+
+// Get type id (e.g., "ns3::TcpBbrTcpPacedPacketTime").
+template <class PacingPolicy, class TimingPolicy>
+TypeId TcpBbrT<PacingPolicy, TimingPolicy>::GetTypeId(void) {
+  static TypeId tid = TypeId((std::string("ns3::TcpBbr") +
+                              PacingPolicy::name() +
+                              TimingPolicy::name()).c_str())
+    .SetParent<TcpBbr>()
+    .SetGroupName("Internet")
+    .AddConstructor<TcpBbrT<PacingPolicy, TimingPolicy> >();
+  return tid;
+}
+
+// Get name of congestion control algorithm.
+template <class PacingPolicy, class TimingPolicy>
+std::string TcpBbrT<PacingPolicy, TimingPolicy>::GetName() const {
+  return std::string("TcpBbr") + PacingPolicy::name() + TimingPolicy::name();
+}
+
+// Default constructor.
+template <class PacingPolicy, class TimingPolicy>
+TcpBbrT<PacingPolicy, TimingPolicy>::TcpBbrT() :
+  TcpBbr() {
+  m_pacing_config = PacingPolicy::config;
+  m_time_config = TimingPolicy::config;
+}
+
+// Copy constructor.
+template <class PacingPolicy, class TimingPolicy>
+TcpBbrT<PacingPolicy, TimingPolicy>::TcpBbrT(const TcpBbrT &sock) :
+  TcpBbr(sock) {
+}
+
+// Set configs from policies (overriding any attributes).
+template <class PacingPolicy, class TimingPolicy>
+void TcpBbrT<PacingPolicy, TimingPolicy>::NotifyConstructionCompleted(void) {
+  m_pacing_config = PacingPolicy::config;
+  m_time_config = TimingPolicy::config;
+  TcpBbr::NotifyConstructionCompleted();
+}
+
+// Set socket's pacing config to policy.
+template <class PacingPolicy, class TimingPolicy>
+void TcpBbrT<PacingPolicy, TimingPolicy>::Init(Ptr<TcpSocketState> tcb) {
+  BBR_LOG_FUNCTION(this << tcb);
+  tcb -> SetPacingConfig(PacingPolicy::config);
+}
+
+// On receiving ack (see TcpBbr), with configs from policies.
+template <class PacingPolicy, class TimingPolicy>
+void TcpBbrT<PacingPolicy, TimingPolicy>::PktsAcked(Ptr<TcpSocketState> tcb,
+                                                    uint32_t packets_acked,
+                                                    const Time &rtt) {
+  BBR_PROFILE(bbr::PROFILE_PKTS_ACKED);
+  BBR_LOG_FUNCTION(this << packets_acked << rtt);
+  pktsAcked<PacingPolicy, TimingPolicy>(tcb, packets_acked, rtt);
+}
+
+// Copy BBR' congestion control with copy.
+template <class PacingPolicy, class TimingPolicy>
+Ptr<TcpCongestionOps> TcpBbrT<PacingPolicy, TimingPolicy>::Fork() {
+  return CopyObject<TcpBbrT<PacingPolicy, TimingPolicy> >(this);
+}
+
+// All variants.
+template class ns3::TcpBbrT<bbr::TcpPaced, bbr::PacketTime>;
+template class ns3::TcpBbrT<bbr::TcpPaced, bbr::WallclockTime>;
+template class ns3::TcpBbrT<bbr::AppPaced, bbr::PacketTime>;
+template class ns3::TcpBbrT<bbr::AppPaced, bbr::WallclockTime>;
+template class ns3::TcpBbrT<bbr::NotPaced, bbr::PacketTime>;
+template class ns3::TcpBbrT<bbr::NotPaced, bbr::WallclockTime>;
+template class ns3::TcpBbrT<bbr::EdtPaced, bbr::PacketTime>;
+template class ns3::TcpBbrT<bbr::EdtPaced, bbr::WallclockTime>;
+
+// Register all variants (as NS_OBJECT_ENSURE_REGISTERED).
+static struct TcpBbrTRegistration {
+  TcpBbrTRegistration() {
+    TcpBbrT<bbr::TcpPaced, bbr::PacketTime>::GetTypeId();
+    TcpBbrT<bbr::TcpPaced, bbr::WallclockTime>::GetTypeId();
+    TcpBbrT<bbr::AppPaced, bbr::PacketTime>::GetTypeId();
+    TcpBbrT<bbr::AppPaced, bbr::WallclockTime>::GetTypeId();
+    TcpBbrT<bbr::NotPaced, bbr::PacketTime>::GetTypeId();
+    TcpBbrT<bbr::NotPaced, bbr::WallclockTime>::GetTypeId();
+    TcpBbrT<bbr::EdtPaced, bbr::PacketTime>::GetTypeId();
+    TcpBbrT<bbr::EdtPaced, bbr::WallclockTime>::GetTypeId();
+  }
+} g_tcp_bbr_t_registration;
@@ -20,8 +20,29 @@
 #ifndef TCP_BBR_H
 #define TCP_BBR_H
 
+#include "ns3/log.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
 #include "tcp-congestion-ops.h"       
 #include "tcp-bbr-state.h"            
+#include "tcp-bbr-filter.h"
+#include "tcp-bbr-rate.h"
+
+// Logging for BBR' (as NS_LOG_*, so arguments only evaluated if
+// component and level enabled).  Build with -DTCP_BBR_NO_LOG to strip
+// all BBR' logging, even if ns-3 logging is compiled in.
+#ifdef TCP_BBR_NO_LOG
+#define BBR_LOG_FUNCTION(parameters) do { } while (false)
+#define BBR_LOG_LOGIC(msg) do { } while (false)
+#define BBR_LOG_INFO(msg) do { } while (false)
+#define BBR_LOG_WARN(msg) do { } while (false)
+#else
+#define BBR_LOG_FUNCTION(parameters) NS_LOG_FUNCTION(parameters)
+#define BBR_LOG_LOGIC(msg) NS_LOG_LOGIC(msg)
+#define BBR_LOG_INFO(msg) NS_LOG_INFO(msg)
+#define BBR_LOG_WARN(msg) NS_LOG_WARN(msg)
+#endif
 
 namespace ns3 {
 
@@ -34,14 +55,15 @@ namespace bbr {
 // WALLCLOCK_TIME - Use wall-clock RTT for culling BW window.
 enum enum_time_config {WALLCLOCK_TIME, PACKET_TIME};
 
-// Actual configuration option.
+// Default configuration option (attribute "TimeConfig").
 const enum_time_config TIME_CONFIG = PACKET_TIME;
 //const enum_time_config TIME_CONFIG = WALLCLOCK_TIME;
 
 ///////////////////////////////////////////////////////////////////
 
-// Constants.
-const float VERSION = 1.7;            // See changelog.txt.
+// Constants (all but VERSION are defaults for attributes, see
+// TcpBbr::GetTypeId(), so can be changed per run or per socket).
+const float VERSION = 1.8;            // See changelog.txt.
 const Time INIT_RTT = Time(1000000);  // Nanoseconds (.001 sec).
 const double INIT_BW = 6.0;           // Mb/s. 
 const int RTT_WINDOW_TIME = 10;       // In seconds.
@@ -59,23 +81,52 @@ const float DRAIN_FACTOR = 0.25;      // Decrease when drain.
 const float STARTUP_THRESHOLD = 1.25; // Threshold to exit STARTUP.
 const float STARTUP_GAIN = 2.89;      // Roughly 2/ln(2).
 
+// Send quantum (see Section 4.2.2 in [CCYJ17]):
+// If true, TCP pacing sends bursts of send quantum bytes per event.
+const bool SEND_QUANTUM = false;
+const uint32_t MAX_SEND_QUANTUM = 64 * 1024; // In bytes.
+
 // PROBE_RTT state:
 const float RTT_NOCHANGE_LIMIT = 10;  // To enter (in seconds).
 const float PROBE_RTT_MIN_TIME = 0.2; // Minimun stay time (in seconds).
 
-// Structure for tracking TCP window for estimating BW.
-struct packet_struct {
-  SequenceNumber32 acked;  // Last sequence number acked.
-  SequenceNumber32 sent;   // Next sequence number sent.
-  Time time;               // Time sent.
-  int delivered;           // Delivered bytes.
+// Windowed min filter for RTT estimates (keyed by time stored).
+typedef WindowedFilter<Time, Time, std::less<Time> > rtt_filter;
+
+// Windowed max filters for BW estimates, keyed by packet-timed
+// round (PACKET_TIME) or by time stored (WALLCLOCK_TIME).
+typedef WindowedFilter<double, int, std::greater<double> > bw_round_filter;
+typedef WindowedFilter<double, Time, std::greater<double> > bw_time_filter;
+
+///////////////////////////////////////////////////////////////////
+// Policies, for configs fixed at compile time (see TcpBbrT).
+
+// Pacing policies (see PACING_CONFIG in "tcp-socket-base.h").
+struct TcpPaced {
+  static const enum_pacing_config config = TCP_PACING;
+  static const char *name() { return "TcpPaced"; }
+};
+struct AppPaced {
+  static const enum_pacing_config config = APP_PACING;
+  static const char *name() { return "AppPaced"; }
+};
+struct NotPaced {
+  static const enum_pacing_config config = NO_PACING;
+  static const char *name() { return "NotPaced"; }
+};
+struct EdtPaced {
+  static const enum_pacing_config config = EDT_PACING;
+  static const char *name() { return "EdtPaced"; }
 };
 
-// Structure for storing BW estimates.
-struct bw_struct {
-  Time time;               // Time stored.
-  int round;               // Virtual time stored.
-  double bw_est;           // Bandwidth estimate.
+// Timing policies (see TIME_CONFIG above).
+struct PacketTime {
+  static const enum_time_config config = PACKET_TIME;
+  static const char *name() { return "PacketTime"; }
+};
+struct WallclockTime {
+  static const enum_time_config config = WALLCLOCK_TIME;
+  static const char *name() { return "WallclockTime"; }
 };
 
 } // end of namespace bbr
@@ -104,6 +155,17 @@ public:
   // Get name of congestion control algorithm.
   std::string GetName() const;
 
+  // Return current state (e.g., to seed "State" trace sinks).
+  bbr::bbr_state getState() const;
+
+  // Return max BW of window (Mb/s, e.g., to seed "MaxBw" trace sinks).
+  double getMaxBw() const;
+
+  // Trace signatures (see GetTypeId() for trace sources).
+  typedef void (* StateCallback)(bbr::bbr_state old_state,
+                                 bbr::bbr_state new_state);
+  typedef void (* RateSampleCallback)(const bbr::rate_sample &rs);
+
   // Default constructor.
   TcpBbr();
 
@@ -116,7 +178,17 @@ public:
   // Before sending packet:
   // - Record information to estimate BW
   virtual void Send(Ptr<TcpSocketBase> tsb, Ptr<TcpSocketState> tcb,
-                    SequenceNumber32 seq, bool isRetrans);
+                    SequenceNumber32 seq, uint32_t size, bool isRetrans);
+
+  // When application has no more data to send:
+  // - mark rate samples application limited
+  // - if idle, restart pacing at BW estimate
+  virtual void AppLimited(Ptr<TcpSocketBase> tsb, Ptr<TcpSocketState> tcb);
+
+  // On SACK (before PktsAcked() for same ack):
+  // - deliver segments newly SACKed, for BW est
+  virtual void Sacked(Ptr<TcpSocketState> tcb,
+                      const TcpOptionSack::SackList &list);
 
   // On receiving ack:
   // - update congestion window
@@ -129,6 +201,10 @@ public:
   // Copy BBR' congestion control with copy.
   virtual Ptr<TcpCongestionOps> Fork();
 
+  // Assign fixed random variable stream (for PROBE_BW start phase),
+  // so runs are reproducible.  Return number of streams assigned (1).
+  virtual int64_t AssignStreams(int64_t stream);
+
   // BBR' ignores calls to increase window.
   virtual void IncreaseWindow(Ptr<TcpSocketState> tcb, uint32_t segs_acked);
 
@@ -143,6 +219,7 @@ private:
   
   // Return bandwidth-delay product (in Mbits).
   double getBDP() const;
+  template <class T> double getBDP() const;
 
   // Return round-trip time (min of window, in seconds).
   // Return -1 if no RTT estimates yet.
@@ -151,6 +228,7 @@ private:
   // Return bandwidth (max of window, in Mb/s).
   // Return -1 if no BW estimates yet.
   double getBW() const;
+  template <class T> double getBW() const;
 
   // Remove BW estimates that are too old (greater than 10 RTTs).
   void cullBWwindow();
@@ -159,32 +237,121 @@ private:
   void cullRTTwindow();
 
   // Compute target TCP cwnd (m_cwnd) based on BDP and gain.
-  void updateTargetCwnd();
+  template <class P, class T> void updateTargetCwnd();
 
   // Check if should enter PROBE_RTT state.
   bool checkProbeRTT();
 
+  // Return send quantum (in bytes) for pacing rate (in Mb/s).
+  uint32_t getSendQuantum(double pacing_rate, uint32_t mss) const;
+
+  // Return bytes newly delivered by ack (cumulatively acked or SACKed).
+  uint32_t updateDelivered(Ptr<TcpSocketState> tcb);
+
  protected:
-  double m_pacing_gain;                    // Scale estimated BDP for pacing.
-  double m_cwnd_gain;                      // Scale estimated BDP for cwnd.
-  int m_round;                             // For recording virtual RTT time.
-  int m_delivered;                         // For computing virtual RTT rounds.
-  int m_next_round_delivered;              // For computing virtual RTT rounds.
-  std::map<Time, Time> m_rtt_window;       // For computing min RTT.
-  std::vector<bbr::bw_struct> m_bw_window; // For computing max BW.
-  std::vector<bbr::packet_struct> m_pkt_window; // For estimating BW from ACKs.
+  // Enter first state and log configuration (once attributes are set).
+  virtual void NotifyConstructionCompleted(void);
+
+  // On receiving ack, as PktsAcked(), for pacing policy P and
+  // timing policy T (hot path, so specialised at compile time).
+  template <class P, class T>
+  void pktsAcked(Ptr<TcpSocketState> tcb, uint32_t packets_acked,
+                 const Time &rtt);
+
+  TracedValue<double> m_pacing_gain;       // Scale estimated BDP for pacing.
+  TracedValue<double> m_cwnd_gain;         // Scale estimated BDP for cwnd.
+  TracedValue<int32_t> m_round;            // For recording virtual RTT time.
+  uint64_t m_next_round_delivered;         // For computing virtual RTT rounds.
+  SequenceNumber32 m_delivered_ack;        // Highest cumulative ack counted.
+  uint32_t m_delivered_credit;             // Bytes counted before acked.
+  uint32_t m_sacked_bytes;                 // Bytes SACKed by current ack.
+  bool m_sack_seen;                        // True if current ack has SACK.
+  bbr::rtt_filter m_rtt_window;            // For computing min RTT.
+  bbr::bw_round_filter m_bw_window;         // For computing max BW.
+  bbr::bw_time_filter m_bw_time_window;    // For max BW (WALLCLOCK_TIME).
+  bbr::RateSampler m_rate;                 // For estimating BW from ACKs.
   uint32_t m_bytes_in_flight;              // Bytes in flight (from socket base).
   Time m_min_rtt_change;                   // Last time min RTT changed.
-  double m_cwnd;                           // Current taraget/max cwnd.
+  bool m_filled_pipe;                      // True once STARTUP found full BW.
+  TracedValue<double> m_cwnd;              // Current taraget/max cwnd.
   double m_prior_cwnd;                     // Cwnd prior to Fast Recovery.
   Time m_packet_conservation;              // Time to stop modulation.
-  bool m_in_retrans_seq;                   // True if in retrans seq.
-  SequenceNumber32 m_retrans_seq;          // Retrans seq end.
   BbrStateMachine m_machine;               // State machine.
   BbrStartupState m_state_startup;         // STARTUP state.
   BbrDrainState m_state_drain;             // DRAIN state.
   BbrProbeBWState m_state_probe_bw;        // PROBE_BW state.
   BbrProbeRTTState m_state_probe_rtt;      // PROBE_RTT state.
+  enum_pacing_config m_pacing_config;      // Pacing config (from socket).
+  Ptr<UniformRandomVariable> m_rng;        // For PROBE_BW start phase.
+
+  // Traces (only for reporting).
+  TracedValue<double> m_max_bw;            // Max BW of window (Mb/s).
+  TracedValue<Time> m_min_rtt;             // Min RTT of window.
+  TracedCallback<bbr::bbr_state, bbr::bbr_state> m_state_trace; // State changes.
+  TracedCallback<const bbr::rate_sample &> m_rate_sample_trace; // Rate samples.
+
+  // Attributes (defaults are constants in "tcp-bbr.h").
+  bbr::enum_time_config m_time_config;     // Time config for BW window.
+  Time m_init_rtt;                         // RTT before estimates.
+  double m_init_bw;                        // BW before estimates (Mb/s).
+  Time m_rtt_window_time;                  // RTT window length.
+  int m_bw_window_time;                    // BW window length (in RTTs).
+  uint32_t m_min_cwnd;                     // Minimum cwnd (in bytes).
+  float m_pacing_factor;                   // Factor of BW to pace.
+  float m_steady_factor;                   // PROBE_BW steady gain.
+  float m_probe_factor;                    // PROBE_BW add when probe.
+  float m_drain_factor;                    // PROBE_BW decrease when drain.
+  float m_startup_threshold;               // Threshold to exit STARTUP.
+  float m_startup_gain;                    // STARTUP gain.
+  bool m_send_quantum;                     // Pace in send quantum bursts.
+  uint32_t m_max_send_quantum;             // Max send quantum (in bytes).
+  Time m_rtt_nochange_limit;               // Time to enter PROBE_RTT.
+  Time m_probe_rtt_min_time;               // Min time in PROBE_RTT.
+};
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief TCP BBR' with pacing and timing configs fixed at compile time.
+ *
+ * PacingPolicy is one of bbr::TcpPaced, bbr::AppPaced, bbr::NotPaced,
+ * bbr::EdtPaced and TimingPolicy one of bbr::PacketTime,
+ * bbr::WallclockTime.  Each variant is registered (e.g.,
+ * "ns3::TcpBbrTcpPacedPacketTime"), so can be picked at run time
+ * (e.g., via "ns3::TcpL4Protocol::SocketType").  The variant also sets
+ * the socket's pacing config.
+ */
+template <class PacingPolicy, class TimingPolicy>
+class TcpBbrT : public TcpBbr {
+
+public:
+
+  // Get type id.
+  static TypeId GetTypeId(void);
+
+  // Get name of congestion control algorithm.
+  std::string GetName() const;
+
+  // Default constructor.
+  TcpBbrT();
+
+  // Copy constructor.
+  TcpBbrT(const TcpBbrT &sock);
+
+  // Set socket's pacing config to policy.
+  virtual void Init(Ptr<TcpSocketState> tcb);
+
+  // On receiving ack (see TcpBbr), with configs from policies.
+  virtual void PktsAcked(Ptr<TcpSocketState> tcb, uint32_t packets_acked,
+                         const Time &rtt);
+
+  // Copy BBR' congestion control with copy.
+  virtual Ptr<TcpCongestionOps> Fork();
+
+protected:
+
+  // Set configs from policies (overriding any attributes).
+  virtual void NotifyConstructionCompleted(void);
 };
 
 } // end of namespace ns3
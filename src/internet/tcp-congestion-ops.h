@@ -22,6 +22,7 @@
 #include "ns3/object.h"
 #include "ns3/timer.h"
 #include "ns3/tcp-socket-base.h"
+#include "ns3/tcp-option-sack.h"
 
 namespace ns3 {
 
@@ -122,11 +123,41 @@ public:
   {
   }
 
+  // Enable congestion control-specific initialization
+  // (invoked in TcpSocketBase::SetCongestionControlAlgorithm()).
+  virtual void Init(Ptr<TcpSocketState> tcb)
+  {
+  }
+
   // Enable congestion control-specific Send() functionality
-  // (invoked in TcpSocketBase::SendDataPacketReal()).
+  // (invoked in TcpSocketBase::SendDataPacketReal()), with size of
+  // segment [seq, seq + size) sent.
   virtual void Send(Ptr<TcpSocketBase> tsb, Ptr<TcpSocketState> tcb,
-                    SequenceNumber32 seq, bool isRetrans)
+                    SequenceNumber32 seq, uint32_t size, bool isRetrans)
+  {
+  }
+
+  // Enable congestion control-specific app-limited functionality
+  // (invoked in TcpSocketBase::SendPendingData() when the application
+  // has no more data to send and the window is not full).
+  virtual void AppLimited(Ptr<TcpSocketBase> tsb, Ptr<TcpSocketState> tcb)
+  {
+  }
+
+  // Enable congestion control-specific SACK functionality
+  // (invoked in TcpSocketBase::ProcessOptionSack(), before PktsAcked()
+  // for the same ACK).
+  virtual void Sacked(Ptr<TcpSocketState> tcb,
+                      const TcpOptionSack::SackList &list)
+  {
+  }
+
+  // Assign fixed random variable streams (e.g., for BBR' PROBE_BW
+  // start phase), so runs are reproducible.  Return number of streams
+  // assigned (none by default).
+  virtual int64_t AssignStreams(int64_t stream)
   {
+    return 0;
   }
 
   /**
@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// NS includes.
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "tcp-socket-base.h"
+#include "tcp-pacing-scheduler.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("TcpPacingScheduler");
+NS_OBJECT_ENSURE_REGISTERED(TcpPacingScheduler);
+
+// Get type id.
+TypeId TcpPacingScheduler::GetTypeId(void) {
+  static TypeId tid = TypeId("ns3::TcpPacingScheduler")
+    .SetParent<Object>()
+    .SetGroupName("Internet")
+    .AddConstructor<TcpPacingScheduler>()
+    .AddAttribute("Slack",
+                  "Packets due within slack are sent together",
+                  TimeValue(Seconds(EDT_PACING_SLACK)),
+                  MakeTimeAccessor(&TcpPacingScheduler::m_slack),
+                  MakeTimeChecker(Time(0)));
+  return tid;
+}
+
+// Default constructor.
+TcpPacingScheduler::TcpPacingScheduler() :
+  m_event_time(0),
+  m_slack(Seconds(EDT_PACING_SLACK)) {
+  NS_LOG_FUNCTION(this);
+}
+
+// Destructor.
+TcpPacingScheduler::~TcpPacingScheduler() {
+  NS_LOG_FUNCTION(this);
+}
+
+// Cancel timer and let go of sockets.
+void TcpPacingScheduler::DoDispose(void) {
+  NS_LOG_FUNCTION(this);
+  m_event.Cancel();
+  while (!m_heap.empty())
+    m_heap.pop();
+  Object::DoDispose();
+}
+
+// Get scheduler for node, aggregating new one if none.
+Ptr<TcpPacingScheduler> TcpPacingScheduler::GetScheduler(Ptr<Node> node) {
+  Ptr<TcpPacingScheduler> scheduler = node -> GetObject<TcpPacingScheduler>();
+  if (scheduler == 0) {
+    scheduler = CreateObject<TcpPacingScheduler>();
+    node -> AggregateObject(scheduler);
+  }
+  return scheduler;
+}
+
+// Return number of sockets waiting (including stale entries).
+size_t TcpPacingScheduler::size() const {
+  return m_heap.size();
+}
+
+// Wake socket at departure time to send packets that are due.
+void TcpPacingScheduler::schedule(Ptr<TcpSocketBase> socket, Time departure) {
+  NS_LOG_FUNCTION(this << socket << departure);
+  entry e = {departure, socket};
+  m_heap.push(e);
+  setTimer();
+}
+
+// Set timer for earliest departure in heap, if earlier than timer.
+void TcpPacingScheduler::setTimer() {
+  if (m_heap.empty())
+    return;
+
+  Time departure = m_heap.top().departure;
+  if (m_event.IsRunning() && m_event_time <= departure)
+    return;
+
+  m_event.Cancel();
+  m_event_time = Max(departure, Simulator::Now());
+  m_event = Simulator::Schedule(m_event_time - Simulator::Now(),
+                                &TcpPacingScheduler::run, this);
+  NS_LOG_LOGIC(this << " Timer set: " << m_event_time.GetSeconds());
+}
+
+// Send packets due from all sockets, then set timer for next.
+// Sockets whose queue was flushed (or re-scheduled) since being added
+// have stale entries, which are skipped.
+void TcpPacingScheduler::run() {
+  NS_LOG_FUNCTION(this);
+
+  Time due = Simulator::Now() + m_slack;
+  int count = 0;
+  while (!m_heap.empty() && m_heap.top().departure <= due) {
+    entry e = m_heap.top();
+    m_heap.pop();
+    if (e.socket -> m_pacing_wakeup != e.departure)
+      continue;                 // Stale.
+    count++;
+
+    // Send socket's packets due and, if more, wait for next.
+    e.socket -> m_pacing_wakeup = Time(-1);
+    e.socket -> PacePacketsEdt(due);
+    if (!e.socket -> m_pacing_packets.empty() &&
+        e.socket -> m_pacing_wakeup.IsNegative()) {
+      e.socket -> m_pacing_wakeup = e.socket -> m_pacing_packets.front().departure;
+      entry next = {e.socket -> m_pacing_wakeup, e.socket};
+      m_heap.push(next);
+    }
+  }
+  NS_LOG_LOGIC(this << " Sockets served: " << count <<
+               " waiting: " << m_heap.size());
+
+  setTimer();
+}
+
+} // namespace ns3
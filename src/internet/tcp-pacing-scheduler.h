@@ -0,0 +1,94 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2017 WPI, Verizon
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef TCP_PACING_SCHEDULER_H
+#define TCP_PACING_SCHEDULER_H
+
+#include <queue>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+class Node;
+class TcpSocketBase;
+
+///////////////////////////////////////////////////////////////////
+// Node-wide pacing scheduler (for EDT_PACING, see tcp-socket-base.h).
+//
+// Like the Linux fq qdisc, each socket keeps its own queue of paced
+// packets (stamped with departure times), and the scheduler keeps
+// the sockets with packets queued in a heap, ordered by departure
+// time of the packet at the head of each queue.  One timer per node
+// fires at the earliest departure, and sends all packets due from all
+// sockets, so the number of timers doesn't grow with number of flows.
+//
+// One scheduler is aggregated to each node, made on first use.
+class TcpPacingScheduler : public Object {
+
+ public:
+  static TypeId GetTypeId(void);
+
+  TcpPacingScheduler();
+  virtual ~TcpPacingScheduler();
+
+  // Get scheduler for node, aggregating new one if none.
+  static Ptr<TcpPacingScheduler> GetScheduler(Ptr<Node> node);
+
+  // Wake socket at departure time to send packets that are due.
+  void schedule(Ptr<TcpSocketBase> socket, Time departure);
+
+  // Return number of sockets waiting (including stale entries).
+  size_t size() const;
+
+ protected:
+  virtual void DoDispose(void);
+
+ private:
+  // Send packets due from all sockets, then set timer for next.
+  void run();
+
+  // Set timer for earliest departure in heap, if earlier than timer.
+  void setTimer();
+
+  // Socket waiting in heap.
+  struct entry {
+    Time departure;              // Departure of head packet.
+    Ptr<TcpSocketBase> socket;   // Socket with packets queued.
+  };
+
+  // Heap order (earliest departure on top).
+  struct later {
+    bool operator()(const entry &a, const entry &b) const {
+      return a.departure > b.departure;
+    }
+  };
+
+  std::priority_queue<entry, std::vector<entry>, later> m_heap;
+  EventId m_event;               // Timer for earliest departure.
+  Time m_event_time;             // Time timer fires.
+  Time m_slack;                  // Send packets due this soon together.
+};
+
+} // namespace ns3
+
+#endif // TCP_PACING_SCHEDULER_H
@@ -39,6 +39,7 @@
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
 #include "ns3/double.h"
+#include "ns3/enum.h"
 #include "ns3/pointer.h"
 #include "ns3/trace-source-accessor.h"
 #include "tcp-socket-base.h"
@@ -53,6 +54,8 @@
 #include "tcp-option-sack.h"
 #include "rtt-estimator.h"
 #include "tcp-congestion-ops.h"
+#include "tcp-pacing-scheduler.h"
+#include "tcp-bbr-profile.h"
 
 #include <math.h>
 #include <algorithm>
@@ -135,6 +138,20 @@ TcpSocketBase::GetTypeId (void)
                    BooleanValue (true),
                    MakeBooleanAccessor (&TcpSocketBase::m_limitedTx),
                    MakeBooleanChecker ())
+    .AddAttribute ("CongestionOps",
+                   "Congestion control algorithm (e.g., for tracing its state)",
+                   TypeId::ATTR_GET,
+                   PointerValue (),
+                   MakePointerAccessor (&TcpSocketBase::GetCongestionControlAlgorithm),
+                   MakePointerChecker<TcpCongestionOps> ())
+    .AddAttribute ("PacingConfig", "Where packet pacing is done (if at all)",
+                   EnumValue (PACING_CONFIG),
+                   MakeEnumAccessor (&TcpSocketBase::SetPacingConfig,
+                                     &TcpSocketBase::GetPacingConfig),
+                   MakeEnumChecker (TCP_PACING, "TcpPacing",
+                                    APP_PACING, "AppPacing",
+                                    NO_PACING, "NoPacing",
+                                    EDT_PACING, "EdtPacing"))
     .AddTraceSource ("RTO",
                      "Retransmission timeout",
                      MakeTraceSourceAccessor (&TcpSocketBase::m_rto),
@@ -171,6 +188,10 @@ TcpSocketBase::GetTypeId (void)
                      "Socket estimation of bytes in flight",
                      MakeTraceSourceAccessor (&TcpSocketBase::m_bytesInFlight),
                      "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("PacingQueueBytes",
+                     "Bytes queued for pacing in TCP",
+                     MakeTraceSourceAccessor (&TcpSocketBase::m_pacing_bytes),
+                     "ns3::TracedValueCallback::Uint32")
     .AddTraceSource ("HighestRxSequence",
                      "Highest sequence number received from peer",
                      MakeTraceSourceAccessor (&TcpSocketBase::m_highRxMark),
@@ -251,7 +272,9 @@ TcpSocketState::TcpSocketState (void)
     m_nextTxSequence (0),
     m_rcvTimestampValue (0),
     m_rcvTimestampEchoReply (0),
-    m_pacing_rate (0.0) // For pacing
+    m_pacing_rate (0.0), // For pacing
+    m_send_quantum (0),  // For pacing
+    m_pacing_config (PACING_CONFIG) // For pacing
 {
 }
 
@@ -268,7 +291,9 @@ TcpSocketState::TcpSocketState (const TcpSocketState &other)
     m_nextTxSequence (other.m_nextTxSequence),
     m_rcvTimestampValue (other.m_rcvTimestampValue),
     m_rcvTimestampEchoReply (other.m_rcvTimestampEchoReply),
-    m_pacing_rate (other.m_pacing_rate) // For pacing
+    m_pacing_rate (other.m_pacing_rate),  // For pacing
+    m_send_quantum (other.m_send_quantum), // For pacing
+    m_pacing_config (other.m_pacing_config) // For pacing
 {
 }
 
@@ -282,6 +307,12 @@ TcpSocketBase::TcpSocketBase (void)
   : TcpSocket (),
     m_pacing_event (),   // For pacing
     m_pacing_packets (), // For pacing
+    m_pacing_bytes (0),  // For pacing
+    m_pacing_next (0),   // For pacing
+    m_pacing_scheduler (0), // For pacing
+    m_pacing_wakeup (-1),   // For pacing
+    m_pacing_burst (0),     // For pacing
+    m_pacing_burst_bytes (0), // For pacing
     m_retxEvent (),
     m_lastAckEvent (),
     m_delAckEvent (),
@@ -340,11 +371,6 @@ TcpSocketBase::TcpSocketBase (void)
 {
   NS_LOG_FUNCTION (this);
 
-  if (PACING_CONFIG == TCP_PACING) 
-    NS_LOG_INFO ("PACING_IN_TCP - Pacing in TCP is enabled.");
-  else
-    NS_LOG_INFO ("APP_PACING/NO_PACING - Pacing in TCP is *not* enabled.");
-
   m_rxBuffer = CreateObject<TcpRxBuffer> ();
   m_txBuffer = CreateObject<TcpTxBuffer> ();
   m_tcb      = CreateObject<TcpSocketState> ();
@@ -376,6 +402,12 @@ TcpSocketBase::TcpSocketBase (const TcpSocketBase& sock)
   : TcpSocket (sock),
     m_pacing_event (sock.m_pacing_event),     // For pacing
     m_pacing_packets (sock.m_pacing_packets), // For pacing
+    m_pacing_bytes (sock.m_pacing_bytes),     // For pacing
+    m_pacing_next (sock.m_pacing_next),       // For pacing
+    m_pacing_scheduler (sock.m_pacing_scheduler), // For pacing
+    m_pacing_wakeup (-1),                     // For pacing (not waiting)
+    m_pacing_burst (sock.m_pacing_burst),     // For pacing
+    m_pacing_burst_bytes (sock.m_pacing_burst_bytes), // For pacing
     //copy object::m_tid and socket::callbacks
     m_dupAckCount (sock.m_dupAckCount),
     m_delAckCount (0),
@@ -2667,7 +2699,8 @@ TcpSocketBase::SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool with
   NS_LOG_FUNCTION (this << seq << maxSize << withAck);
 
   // If not TCP pacing, go ahead and send normally.
-  if (PACING_CONFIG == NO_PACING || PACING_CONFIG == APP_PACING)
+  enum_pacing_config pacing_config = m_tcb -> GetPacingConfig();
+  if (pacing_config == NO_PACING || pacing_config == APP_PACING)
     return SendDataPacketReal(seq, maxSize, withAck);
 
   // Pacing, so queue until time to send else send now.
@@ -2679,55 +2712,101 @@ TcpSocketBase::SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool with
   } else {
     NS_LOG_LOGIC (this << " Pacing rate: " << pacing_rate);
 
+    // Copy data from TCP buffer now, since copy also updates buffer
+    // (marks data as sent), and keep it so sending doesn't copy again.
+    Ptr<Packet> p = m_txBuffer->CopyFromSequence(maxSize, seq);
+    uint32_t sz = p->GetSize(); // Size of packet
+
     // Store packet.
-    tcp_pacing_struct packet{seq, maxSize, withAck};
+    tcp_pacing_struct packet{seq, maxSize, withAck, p};
+
+    // If EDT pacing, stamp departure time now, at current pacing rate,
+    // spaced after previous packet.  Packets fitting in send quantum
+    // with pending burst depart with it.
+    if (pacing_config == EDT_PACING) {
+      Time now = Simulator::Now();
+      if (m_pacing_burst_bytes > 0 && m_pacing_burst >= now &&
+          m_pacing_burst_bytes + sz <= m_tcb -> GetSendQuantum()) {
+        m_pacing_burst_bytes += sz;
+      } else {
+        m_pacing_burst = Max(m_pacing_next, now);
+        m_pacing_burst_bytes = sz;
+        m_pacing_next = m_pacing_burst;
+      }
+      packet.departure = m_pacing_burst;
+      m_pacing_next += Seconds(sz * 8 / (pacing_rate * 1000000.0));
+    }
+
     m_pacing_packets.push(packet);
+    m_pacing_bytes += sz;
 
     NS_LOG_LOGIC (this << " Storing: " <<
                  packet.seq << " " << 
                  packet.maxSize << " " <<
-                 packet.withAck);
-                 
-    // If no pending event, immediately schedule.
+                 packet.withAck << " " <<
+                 packet.departure.GetSeconds());
+
+    // If EDT pacing and not waiting (new head of queue), have node
+    // scheduler send when it is due.
+    if (pacing_config == EDT_PACING) {
+      if (m_pacing_wakeup.IsNegative()) {
+        if (m_pacing_scheduler == 0)
+          m_pacing_scheduler = TcpPacingScheduler::GetScheduler(m_node);
+        m_pacing_wakeup = packet.departure;
+        m_pacing_scheduler -> schedule(this, packet.departure);
+      }
+      return sz;
+    }
+
+    // If no pending event (pacer idle), schedule for when previous
+    // packet's pacing interval ends (now, if already over).
     if (m_pacing_event.IsExpired()) {
-      m_pacing_event = Simulator::ScheduleNow(&TcpSocketBase::PacePackets, this);
-      NS_LOG_LOGIC (this << " Previous event expired. Scheduling immediately. event_id: " << m_pacing_event.GetUid() << "  timestamp: " << m_pacing_event.GetTs()/1000000000.0);
+      Time delay = Max(m_pacing_next - Simulator::Now(), Time(0));
+      m_pacing_event = Simulator::Schedule(delay, &TcpSocketBase::PacePackets, this);
+      NS_LOG_LOGIC (this << " Pacer idle. Scheduling in " << delay.GetSeconds() << " event_id: " << m_pacing_event.GetUid() << "  timestamp: " << m_pacing_event.GetTs()/1000000000.0);
     }
 
-    // Return size that would have been sent so app knows it's scheduled.
-    Ptr<Packet> p = m_txBuffer->CopyFromSequence(maxSize, seq);
-    uint32_t sz = p->GetSize(); // Size of packet
+    // Return size that will be sent so app knows it's scheduled.
     return sz;
   }
 }
 
-// Send next packet in queue and set timer for subsequent send.
+// Send next packet in queue (or packets, up to send quantum) and set
+// timer for subsequent send.
+// Pacer goes idle (no timer) when queue is empty, and SendDataPacket()
+// restarts it when next packet is queued.
 void TcpSocketBase::PacePackets () {
-  double size;
+  BBR_PROFILE(bbr::PROFILE_PACE_PACKETS);
+  double size = 0;
   NS_LOG_FUNCTION (this);
 
   // If pacing queue empty, app hasn't provided more data.
   NS_LOG_INFO (this << " Pacing packets: " << m_pacing_packets.size());
   if (m_pacing_packets.empty()) {
-    NS_LOG_LOGIC (this << " Pacing list empty.");
-    size = 1000; // Temporary packet bytes for computing pacing interval.
-  } else {
+    NS_LOG_LOGIC (this << " Pacing list empty. Pacer idle.");
+    return;
+  }
 
+  // Send packets while they fit in send quantum (at least one).
+  uint32_t quantum = m_tcb -> GetSendQuantum();
+  do {
     // Get next packet to send.
     tcp_pacing_struct packet = m_pacing_packets.front();
     m_pacing_packets.pop();
+    m_pacing_bytes -= packet.packet->GetSize();
 
     NS_LOG_LOGIC (this << " Sending real: " <<
                  packet.seq << " " << 
                  packet.maxSize << " " <<
                  packet.withAck);
 
-    // Send it.
-    SendDataPacketReal(packet.seq, packet.maxSize, packet.withAck);
+    // Add size for computing pacing interval (before headers added).
+    size += packet.packet->GetSize();
 
-    // Get size for computing pacing interval.
-    size = packet.maxSize;
-  }
+    // Send it.
+    SendDataPacketReal(packet.seq, packet.maxSize, packet.withAck, packet.packet);
+  } while (!m_pacing_packets.empty() &&
+           size + m_pacing_packets.front().packet->GetSize() <= quantum);
 
   // Schedule next send event.
   double pacing_rate = m_tcb -> GetPacingRate();
@@ -2735,6 +2814,15 @@ void TcpSocketBase::PacePackets () {
     size *= 8 / 1000000.0;  // Convert to Mbits.
     double delta = size / pacing_rate; // Convert to seconds.
     delta *= 1000000000;  // Convert to nanoseconds.
+    m_pacing_next = Simulator::Now() + Time(delta);
+
+    // No more packets --> idle until SendDataPacket() queues one.
+    if (m_pacing_packets.empty()) {
+      NS_LOG_LOGIC (this << " Pacing list empty. Pacer idle until: " <<
+                    m_pacing_next.GetSeconds());
+      return;
+    }
+
     m_pacing_event.Cancel();  // Cancel any pending events. Needed?
     m_pacing_event = Simulator::Schedule(Time(delta),
                                          &TcpSocketBase::PacePackets, this);
@@ -2747,12 +2835,46 @@ void TcpSocketBase::PacePackets () {
   } else
     NS_LOG_LOGIC (this << " rate: " << pacing_rate << " (no pacing)");  
 }
+
+// Send all packets in queue departing by due (EDT_PACING).
+// Called by node pacing scheduler, which waits for next departure.
+void TcpSocketBase::PacePacketsEdt (Time due) {
+  BBR_PROFILE(bbr::PROFILE_PACE_PACKETS);
+  NS_LOG_FUNCTION (this << due);
+
+  int count = 0;
+  while (!m_pacing_packets.empty() &&
+         m_pacing_packets.front().departure <= due) {
+    tcp_pacing_struct packet = m_pacing_packets.front();
+    m_pacing_packets.pop();
+    m_pacing_bytes -= packet.packet->GetSize();
+    SendDataPacketReal(packet.seq, packet.maxSize, packet.withAck, packet.packet);
+    count++;
+  }
+  NS_LOG_LOGIC (this << " Sent: " << count <<
+                " Pacing packets: " << m_pacing_packets.size());
+}
+  
+// Tell congestion control if sending is limited by the application:
+// less than 1 MSS unsent, nothing waiting to be paced, window not full
+// and not recovering from loss (see Section 4.1.1.4 in BBR draft).
+void TcpSocketBase::CheckAppLimited () {
+  if (m_tcb->m_congState != TcpSocketState::CA_OPEN ||
+      !m_pacing_packets.empty() ||
+      m_txBuffer->SizeFromSequence (m_tcb->m_nextTxSequence) >= m_tcb->m_segmentSize ||
+      BytesInFlight () >= m_tcb->m_cWnd.Get ())
+    return;
+
+  NS_LOG_LOGIC (this << " App limited.  In flight: " << BytesInFlight ());
+  m_congestionControl->AppLimited (this, m_tcb);
+}
   
 /* Really send the data packet.
-   Extract at most maxSize bytes from the TxBuffer at sequence seq, add the
-   TCP header, and send to TcpL4Protocol */
+   Extract at most maxSize bytes from the TxBuffer at sequence seq (unless
+   already extracted into p), add the TCP header, and send to TcpL4Protocol */
 uint32_t
-TcpSocketBase::SendDataPacketReal (SequenceNumber32 seq, uint32_t maxSize, bool withAck)
+TcpSocketBase::SendDataPacketReal (SequenceNumber32 seq, uint32_t maxSize, bool withAck,
+                                   Ptr<Packet> p)
 {
   NS_LOG_FUNCTION (this << seq << maxSize << withAck);
 
@@ -2762,14 +2884,17 @@ TcpSocketBase::SendDataPacketReal (SequenceNumber32 seq, uint32_t maxSize, bool
       isRetransmission = true;
     }
 
+  if (p == 0)
+    {
+      p = m_txBuffer->CopyFromSequence (maxSize, seq);
+    }
+  uint32_t sz = p->GetSize (); // Size of packet
+
   ////////////////////////////////////////////////////////
   // Hook for congestion control-specific Send() method.
   // (Added for BBR' support.)
-  m_congestionControl->Send(this, m_tcb, seq, isRetransmission); 
+  m_congestionControl->Send(this, m_tcb, seq, sz, isRetransmission); 
   ////////////////////////////////////////////////////////
-
-  Ptr<Packet> p = m_txBuffer->CopyFromSequence (maxSize, seq);
-  uint32_t sz = p->GetSize (); // Size of packet
   uint8_t flags = withAck ? TcpHeader::ACK : 0;
   uint32_t remainingData = m_txBuffer->SizeFromSequence (seq + SequenceNumber32 (sz));
 
@@ -2927,6 +3052,7 @@ TcpSocketBase::SendPendingData (bool withAck)
   NS_LOG_FUNCTION (this << withAck);
   if (m_txBuffer->Size () == 0)
     {
+      CheckAppLimited ();
       return false;                           // Nothing to send
     }
   if (m_endPoint == 0 && m_endPoint6 == 0)
@@ -3036,6 +3162,7 @@ TcpSocketBase::SendPendingData (bool withAck)
     {
       NS_LOG_DEBUG ("SendPendingData no segments sent");
     }
+  CheckAppLimited ();
   return nPacketsSent;
 }
 
@@ -3414,6 +3541,11 @@ TcpSocketBase::ReTxTimeout ()
                << m_pacing_packets.size());
   while (!m_pacing_packets.empty())
     m_pacing_packets.pop();
+  m_pacing_bytes = 0;
+  if (m_tcb -> GetPacingConfig() == EDT_PACING) {
+    m_pacing_wakeup = Time(-1);       // Scheduler entry is now stale.
+    m_pacing_next = Simulator::Now(); // Departure times booked are void.
+  }
   
   NS_LOG_DEBUG ("RTO. Reset cwnd to " <<  m_tcb->m_cWnd << ", ssthresh to " <<
                 m_tcb->m_ssThresh << ", restart from seqnum " <<
@@ -3829,6 +3961,13 @@ TcpSocketBase::ProcessOptionSack (const Ptr<const TcpOption> option)
 
   Ptr<const TcpOptionSack> s = DynamicCast<const TcpOptionSack> (option);
   TcpOptionSack::SackList list = s->GetSackList ();
+
+  ////////////////////////////////////////////////////////
+  // Hook for congestion control-specific Sacked() method.
+  // (Added for BBR' support.)
+  m_congestionControl->Sacked (m_tcb, list);
+  ////////////////////////////////////////////////////////
+
   return m_txBuffer->Update (list);
 }
 
@@ -4039,6 +4178,18 @@ TcpSocketBase::SetCongestionControlAlgorithm (Ptr<TcpCongestionOps> algo)
 {
   NS_LOG_FUNCTION (this << algo);
   m_congestionControl = algo;
+
+  ////////////////////////////////////////////////////////
+  // Hook for congestion control-specific Init() method.
+  // (Added for BBR' support.)
+  m_congestionControl->Init (m_tcb);
+  ////////////////////////////////////////////////////////
+}
+
+Ptr<TcpCongestionOps>
+TcpSocketBase::GetCongestionControlAlgorithm (void) const
+{
+  return m_congestionControl;
 }
 
 Ptr<TcpSocketBase>
@@ -4088,28 +4239,63 @@ void TcpSocketState::SetPacingRate(double pacing_rate) {
   m_pacing_rate = pacing_rate;
 }
 
+// Get send quantum.
+uint32_t TcpSocketState::GetSendQuantum() const {
+  return m_send_quantum;
+}
+
+// Set send quantum.
+void TcpSocketState::SetSendQuantum(uint32_t send_quantum) {
+  m_send_quantum = send_quantum;
+}
+
+// Get pacing configuration.
+enum_pacing_config TcpSocketState::GetPacingConfig() const {
+  return m_pacing_config;
+}
+
+// Set pacing configuration.
+void TcpSocketState::SetPacingConfig(enum_pacing_config pacing_config) {
+  m_pacing_config = pacing_config;
+}
+
+// Get pacing configuration (in tcp socket state).
+enum_pacing_config TcpSocketBase::GetPacingConfig() const {
+  return m_tcb -> GetPacingConfig();
+}
+
+// Set pacing configuration (in tcp socket state).
+void TcpSocketBase::SetPacingConfig (enum_pacing_config pacing_config) {
+  NS_LOG_FUNCTION (this << pacing_config);
+  if (pacing_config == TCP_PACING || pacing_config == EDT_PACING)
+    NS_LOG_INFO ("TCP_PACING/EDT_PACING - Pacing in TCP is enabled.");
+  else
+    NS_LOG_INFO ("APP_PACING/NO_PACING - Pacing in TCP is *not* enabled.");
+  m_tcb -> SetPacingConfig(pacing_config);
+}
+
 // Get pacing rate (in tcp socket state).
 double TcpSocketBase::GetPacingRate() const {
   NS_LOG_FUNCTION (this);
   return m_tcb -> GetPacingRate();
 }    
 
+// Get congestion window (in tcp socket state).
+uint32_t TcpSocketBase::GetCwnd () const {
+  NS_LOG_FUNCTION (this);
+  return m_tcb -> m_cWnd;
+}
+
 // Set pacing rate (in tcp socket state).
 void TcpSocketBase::SetPacingRate (double pacing_rate) {
   NS_LOG_FUNCTION (this << pacing_rate);
   m_tcb -> SetPacingRate(pacing_rate);
 }
  
-// Compute total bytes in pacing packet queue.
+// Get total bytes in pacing packet queue.
+// (Kept as packets are queued/sent, so no need to walk queue.)
 int TcpSocketBase::pacingQueueBytes (void) const {
-  int pacing_bytes = 0;
-  std::queue<tcp_pacing_struct> temp_q = m_pacing_packets;
-  while (!temp_q.empty()) {
-    tcp_pacing_struct packet = m_pacing_packets.front();
-    pacing_bytes += packet.maxSize;
-    temp_q.pop();
-  }
-  return pacing_bytes;
+  return m_pacing_bytes;
 }
 
 // ADDITIONS FOR PACING: END
@@ -28,14 +28,25 @@
 // TCP_PACING - Packet pacing is done in TCP (in socket-base.cc).
 // APP_PACING - Packet pacing is NOT done in TCP, only in the application.
 // NO_PACING - No packet pacing is done (BBR' adjusts accordingly).
-enum enum_pacing_config {TCP_PACING, APP_PACING, NO_PACING};
-
-// Actual configuration option.
+// EDT_PACING - Packet pacing is done in TCP, with each packet stamped
+//              with earliest departure time when queued (as Linux),
+//              and sent by one scheduler per node for all sockets
+//              (as Linux fq, in tcp-pacing-scheduler.cc).
+enum enum_pacing_config {TCP_PACING, APP_PACING, NO_PACING, EDT_PACING};
+
+// Default configuration option (attribute "PacingConfig" of
+// TcpSocketBase, so can be changed per run or per socket).
 const enum_pacing_config PACING_CONFIG = TCP_PACING;
 //const enum_pacing_config PACING_CONFIG = NO_PACING;
 //const enum_pacing_config PACING_CONFIG = APP_PACING;
+//const enum_pacing_config PACING_CONFIG = EDT_PACING;
+
+// EDT_PACING - Packets due within this slack are sent together (as
+// Linux fq timer slack), so high rates don't need an event per packet.
+// Default for attribute "Slack" of TcpPacingScheduler.
+const double EDT_PACING_SLACK = 0.00001; // In seconds.
 
-const float PACING_VERSION = 1.1;  // See changelog.txt.
+const float PACING_VERSION = 1.6;  // See changelog.txt.
 
 // ADDITIONS FOR PACING: END
 ///////////////////////////////////////////////////////////////////
@@ -65,6 +76,7 @@ class Packet;
 class TcpL4Protocol;
 class TcpHeader;
 class TcpCongestionOps;
+class TcpPacingScheduler;
 
 /**
  * \ingroup tcp
@@ -211,8 +223,15 @@ public:
 
   void SetPacingRate (double pacing_rate);
   double GetPacingRate () const;
+  void SetSendQuantum (uint32_t send_quantum);
+  uint32_t GetSendQuantum () const;
+  void SetPacingConfig (enum_pacing_config pacing_config);
+  enum_pacing_config GetPacingConfig () const;
 protected:
   double            m_pacing_rate;                 // Pacing rate (in Mb/s).
+  uint32_t          m_send_quantum;                // Bytes per pacing event
+                                                   // (0 for one packet).
+  enum_pacing_config m_pacing_config;              // Pacing configuration.
 
 };
 
@@ -221,6 +240,8 @@ struct tcp_pacing_struct {
   SequenceNumber32 seq;    // Seq location in TCP buffer.
   uint32_t maxSize;        // Bytes to extract.
   bool withAck;            // Include ack or not.
+  Ptr<Packet> packet;      // Data copied from TCP buffer when queued.
+  Time departure;          // Earliest departure time (EDT_PACING only).
 };
   
 // ADDITIONS FOR PACING: END
@@ -359,6 +380,9 @@ public:
    */
   friend class TcpGeneralTest;
 
+  // Node-wide pacing scheduler sends packets for EDT_PACING.
+  friend class TcpPacingScheduler;
+
   /**
    * Create an unbound TCP socket
    */
@@ -496,6 +520,13 @@ public:
    */
   void SetCongestionControlAlgorithm (Ptr<TcpCongestionOps> algo);
 
+  /**
+   * \brief Get the congestion control algorithm installed on this socket
+   *
+   * \returns the algorithm (e.g., for attribute "CongestionOps")
+   */
+  Ptr<TcpCongestionOps> GetCongestionControlAlgorithm (void) const;
+
   // Necessary implementations of null functions from ns3::Socket
   virtual enum SocketErrno GetErrno (void) const;    // returns m_errno
   virtual enum SocketType GetSocketType (void) const; // returns socket type
@@ -692,7 +723,9 @@ protected:
    * \returns the number of bytes sent
    */
   uint32_t SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool withAck);
-  uint32_t SendDataPacketReal (SequenceNumber32 seq, uint32_t maxSize, bool withAck);
+  // If p given, it holds data already copied from TxBuffer at seq.
+  uint32_t SendDataPacketReal (SequenceNumber32 seq, uint32_t maxSize, bool withAck,
+                               Ptr<Packet> p = 0);
 
   /**
    * \brief Send a empty packet that carries a flag, e.g., ACK
@@ -1117,13 +1150,24 @@ protected:
 public:  
   void SetPacingRate (double pacing_rate);
   double GetPacingRate () const;
+  uint32_t GetCwnd () const;
+  void SetPacingConfig (enum_pacing_config pacing_config);
+  enum_pacing_config GetPacingConfig () const;
   virtual int pacingQueueBytes (void) const;
 
 protected:
   EventId           m_pacing_event;                // Pacing event.
   std::queue<tcp_pacing_struct> m_pacing_packets;  // Pacing packets.
+  TracedValue<uint32_t> m_pacing_bytes;            // Bytes in pacing queue.
+  Time              m_pacing_next;                 // Earliest next send time.
+  Ptr<TcpPacingScheduler> m_pacing_scheduler;      // Node scheduler (EDT).
+  Time              m_pacing_wakeup;               // When scheduler wakes (EDT).
+  Time              m_pacing_burst;                // Departure of burst (EDT).
+  uint32_t          m_pacing_burst_bytes;          // Bytes in burst (EDT).
 private:
   void PacePackets();
+  void PacePacketsEdt(Time due);
+  void CheckAppLimited();
   // ADDITIONS FOR PACING: END
   //////////////////////////////
   